@@ -0,0 +1,122 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// First bytes of a cache file
+#define CACHE_MAGIC 0x326863636d726166ULL // "farmcch2"
+
+// Number of entries of a new cache, doubled by the compaction when it is half full
+#define CACHE_SLOTS 4096
+
+// Runs an entry survives without being looked up, then the compaction drops it
+#define CACHE_MAX_AGE 16
+
+// States of an entry: free, reserved for a result being calculated, holding the result of its key
+#define CACHE_EMPTY 0
+#define CACHE_PENDING 1
+#define CACHE_VALID 2
+
+// Bytes at the start of a file whose checksum verifies that the file has only grown
+#define CACHE_SAMPLE 4096
+
+// Recompute of the files that have grown since their result was stored
+typedef enum Incremental {
+    INCREMENTAL_OFF,        // The whole file is read
+    INCREMENTAL_APPEND,     // Only the appended bytes are read, the file is taken as append-only
+    INCREMENTAL_VERIFY      // Only the appended bytes are read if the checksum of the first CACHE_SAMPLE bytes is the same
+} Incremental_t;
+
+// Version of a file: the same device, inode, size and modification time are taken as the same contents
+typedef struct FileKey {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+} FileKey_t;
+
+// Entry of the cache, 'run' is the last run that looked it up
+// 'sample' is the checksum of the first CACHE_SAMPLE bytes of the file, 0 if it was not calculated
+typedef struct CacheEntry {
+    FileKey_t key;
+    long result;
+    uint64_t sample;
+    uint32_t state;
+    uint32_t run;
+} CacheEntry_t;
+
+// Header of a cache file, followed by 'capacity' entries, 'count' of them not empty
+typedef struct CacheHeader {
+    uint64_t magic;
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t grown;
+    uint32_t run;
+    uint32_t unused;
+} CacheHeader_t;
+
+/*  Cache of the results in a file mapped in memory, an open addressing hash table keyed by device and inode.
+ *  The Master thread looks up and reserves the entries, a Worker thread fills the entry of the file it calculated.
+ *  The file is locked while it is open, 'hits', 'grown' and 'misses' count the lookups of the current run,
+ *  'overflow' the misses not stored because the table was full, the compaction makes room for them.
+ */
+typedef struct ResultCache {
+    char *pathname;
+    int fd;
+    int refresh;
+    Incremental_t incremental;
+    CacheHeader_t *header;
+    CacheEntry_t *entries;
+    size_t map_size;
+    time_t start;
+    size_t hits;
+    size_t grown;
+    size_t misses;
+    size_t overflow;
+} ResultCache_t;
+
+
+/* -------------------- ResultCache interface -------------------- */
+
+
+// Store the version of the file of status 'statbuf' in 'key'
+extern void keyFile(FileKey_t *key, const struct stat *statbuf);
+
+/*  Open the cache in the file 'pathname', created if it does not exist or if it is not a valid cache.
+ *  If 'refresh' is not zero every lookup misses and the results are stored again,
+ *  'incremental' is the recompute of the files that have grown.
+ *
+ *  RETURN VALUE: pointer to the cache on success
+ *                NULL on error (errno is set, EWOULDBLOCK if another process is using the cache)
+ */
+extern ResultCache_t *openCache(const char pathname[], int refresh, Incremental_t incremental);
+
+/*  Look up 'filename' of version 'key' in the cache pointed to by c, only the Master thread may look up.
+ *  On a miss the entry of the file is reserved and stored in 'entry', NULL if the file cannot be cached,
+ *  the entry is filled with storeCache() once the result is calculated.
+ *
+ *  RETURN VALUE: 1 on a hit, the result is stored in 'result'
+ *                0 on a miss, the first 'offset' bytes of the file have the result stored in 'result'
+ *                  (0 and 0 unless the file has grown and the cache is incremental)
+ */
+extern int lookupCache(ResultCache_t *c, const char filename[], const FileKey_t *key, long *result, off_t *offset, CacheEntry_t **entry);
+
+// Store 'result' in the entry reserved by lookupCache() pointed to by e, from any thread
+extern void storeCache(CacheEntry_t *e, long result);
+
+/*  Close the cache pointed to by c, compacting its file if the entries not used for CACHE_MAX_AGE runs
+ *  are at least a quarter of the entries or if the table must grow. The cache is freed also on error.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+extern int closeCache(ResultCache_t *c);
+
+#endif /* __CACHE_H__ */
@@ -1,10 +1,100 @@
 #ifndef __COLLECTOR_H__
 #define __COLLECTOR_H__
 
+#include <stdint.h>
+#include <shmring.h>
+#include <pathtable.h>
+
 // Pathname to UNIX socket 
 #define SOCK_PATHNAME "farm.sck"
 
-// Code exec by Collector process
-extern void exec_collector();
+/*  The first message of the Master process is the number of results to keep (int): 0 all of them,
+ *  k > 0 the k smallest, k < 0 the -k largest. It is followed by the memory cap of the results in bytes (long), 0 for no cap,
+ *  by the number of threads sorting and printing the results (int), by the output format (int, Output_t) and by the replace flag (int):
+ *  if set a new result of a file replaces its previous one, the number of results is 0 and there is no memory cap.
+ *
+ *  Opcodes received by the Collector process. The files are referred to by their ID in the table of the paths
+ *  shared by the Master process, the number of results is not known in advance, the exit opcode marks the end of the stream of results.
+ */
+#define OPCODE_EXIT 0
+#define OPCODE_PRINT -1
+
+/*  A batch of results: number of results (int) and length of the payload (int) followed by the payload,
+ *  the results one after the other (FileResult_t).
+ */
+#define OPCODE_BATCH -2
+
+/*  A new Worker channel, the Collector side of the connected socket is passed with the opcode (SCM_RIGHTS).
+ *  Worker threads send results on their own channel and close it when they terminate.
+ */
+#define OPCODE_CHANNEL -3
+
+// Print only the results arrived after the previous print
+#define OPCODE_DELTA -4
+
+// Maximum length of the payload of a batch
+#define BATCH_MAX (64 * 1024)
+
+// Result of a file in a batch, with the ID of the file in the table of the paths and the sequence number of its submission
+typedef struct FileResult {
+    uint64_t id;
+    uint64_t submission;
+    long result;
+} FileResult_t;
+
+// Results not yet sent on a channel to the Collector process, sent together as one batch
+typedef struct ResultBatch {
+    FileResult_t payload[BATCH_MAX / sizeof(FileResult_t)];
+    int count;
+} ResultBatch_t;
+
+// Output format of the results
+typedef enum Output {
+    OUTPUT_TEXT,        // A line for each result: result and filename
+    OUTPUT_BINARY       // A block for each print: header, records and string table
+} Output_t;
+
+/*  Binary output: each print is a block made of a header, the records of the results in ascending order
+ *  and the string table of their filenames (including '\0'), all in the byte order of the host.
+ *  The records start right after the header and the string table right after the records,
+ *  the offsets of the filenames are relative to the start of the string table.
+ */
+#define BINARY_MAGIC "FARMRES"
+#define BINARY_VERSION 1
+
+typedef struct BinaryHeader {
+    char magic[8];              // BINARY_MAGIC including '\0'
+    uint32_t version;           // BINARY_VERSION
+    uint32_t record_size;       // sizeof(BinaryRecord_t)
+    uint64_t n_records;
+    uint64_t strings_size;      // Size in bytes of the string table
+} BinaryHeader_t;
+
+typedef struct BinaryRecord {
+    int64_t result;
+    uint64_t filename_offset;
+} BinaryRecord_t;
+
+/*  Send the 'result' of the submission number 'submission' of the file of ID 'id' to the Collector process: in the shared
+ *  memory ring 'ring' if not NULL, otherwise in 'batch', sent on the channel 'fd' when it is full.
+ *  Safe to call from many threads, each with its own batch.
+ *
+ *  RETURN VALUE: 1 if the result is in the batch
+ *                0 if the result is in the ring
+ *                -1 on error (errno is set)
+ */
+extern int sendResult(ShmRing_t *ring, ResultBatch_t *batch, int fd, uint64_t id, uint64_t submission, long result);
+
+/*  Send the results in 'batch' on the channel 'fd' as one message with a single writev(), nothing if it is empty.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+extern int flushResults(ResultBatch_t *batch, int fd);
+
+/*  Code exec by Collector process, 'ring' is the shared memory ring created by the Master process before fork(),
+ *  NULL if not available, and 'paths' the table of the paths of the files. Results are read from the ring and from the Worker channels.
+ */
+extern void exec_collector(ShmRing_t *ring, PathTable_t *paths);
 
 #endif /* __COLLECTOR_H__ */
\ No newline at end of file
@@ -1,18 +1,29 @@
 #ifndef __CONCURRENTQUEUE_H__
 #define __CONCURRENTQUEUE_H__
 
-// Concurrent queue data structure
+#include <time.h>
+#include <utils.h>
+#include <task.h>
+
+// Slot of the queue, 'seq' tells whether the slot is free for a producer or holds a task for a consumer
+typedef struct QueueSlot {
+    size_t seq;
+    Task_t *task;
+} QueueSlot_t;
+
+/*  Lock-free bounded MPMC concurrent queue data structure (Vyukov).
+ *  Producers and consumers claim a position with a CAS on 'tail' and 'head', on different cache lines.
+ *  Threads spin briefly on a full/empty queue and then park on the futexes 'not_full' and 'not_empty'.
+ */
 typedef struct ConcurrentQueue {
-    char **buf;
-    size_t head;
-    size_t tail;
+    size_t tail __attribute__((aligned(CACHE_LINE)));
+    unsigned int not_full;
+    unsigned int prod_waiters;
+    size_t head __attribute__((aligned(CACHE_LINE)));
+    unsigned int not_empty;
+    unsigned int cons_waiters;
+    QueueSlot_t *buf __attribute__((aligned(CACHE_LINE)));
     size_t qsize;
-    size_t qlen;
-    size_t num_prod;
-    size_t num_cons;
-    pthread_mutex_t mutex;
-    pthread_cond_t cond_full;
-    pthread_cond_t cond_empty;
 } ConcurrentQueue_t;
 
 
@@ -29,18 +40,39 @@ extern ConcurrentQueue_t *initConcurrentQueue(size_t n);
 // Delete a queue allocated with initConcurrentQueue() pointed to by q
 extern void deleteConcurrentQueue(ConcurrentQueue_t *q);
 
-/*  Insert filename into the queue pointed to by q.
+/*  Insert task into the queue pointed to by q.
  * 
  *  RETURN VALUE: 0 on success
  *                -1 on error (errno is set)
  */
-extern int pushConcurrentQueue(ConcurrentQueue_t *q, char filename[]);
+extern int pushConcurrentQueue(ConcurrentQueue_t *q, Task_t *task);
+
+/*  Insert task into the queue pointed to by q without waiting.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on full queue (errno is set to EAGAIN) or on error (errno is set)
+ */
+extern int tryPushConcurrentQueue(ConcurrentQueue_t *q, Task_t *task);
 
-/* Pull filename from the queue.
+/* Pull task from the queue.
  *
- *  RETURN VALUE: pointer to the filename on success
+ *  RETURN VALUE: pointer to the task on success
  *                NULL on error (errno is set)
  */
-extern char *popConcurrentQueue(ConcurrentQueue_t *q);
+extern Task_t *popConcurrentQueue(ConcurrentQueue_t *q);
+
+/* Pull task from the queue, waiting at most until the absolute time 'abstime' of the CLOCK_MONOTONIC clock.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on timeout (errno is set to ETIMEDOUT) or on error (errno is set)
+ */
+extern Task_t *timedPopConcurrentQueue(ConcurrentQueue_t *q, const struct timespec *abstime);
+
+/* Pull task from the queue without waiting.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on empty queue (errno is set to EAGAIN) or on error (errno is set)
+ */
+extern Task_t *tryPopConcurrentQueue(ConcurrentQueue_t *q);
 
 #endif /* __CONCURRENTQUEUE_H__ */
@@ -0,0 +1,55 @@
+#ifndef __DEQUE_H__
+#define __DEQUE_H__
+
+#include <utils.h>
+#include <task.h>
+
+/*  Bounded Chase-Lev work-stealing deque data structure.
+ *  The owner thread pushes and pops tasks at the bottom, the other threads steal them from the top.
+ */
+typedef struct Deque {
+    long top __attribute__((aligned(CACHE_LINE)));
+    long bottom __attribute__((aligned(CACHE_LINE)));
+    Task_t **buf __attribute__((aligned(CACHE_LINE)));
+    long mask;
+} Deque_t;
+
+
+/* -------------------- Deque interface -------------------- */
+
+
+/*  Initialize a deque of at least 'n' tasks.
+ *
+ *  RETURN VALUE: pointer to the new deque on success
+ *                NULL on error (errno is set)
+ */
+extern Deque_t *initDeque(size_t n);
+
+// Delete a deque allocated with initDeque() pointed to by d, the remaining tasks are deleted
+extern void deleteDeque(Deque_t *d);
+
+/*  Insert 'task' at the bottom of the deque pointed to by d, only the owner thread.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set to EAGAIN if the deque is full)
+ */
+extern int pushDeque(Deque_t *d, Task_t *task);
+
+/*  Pull a task from the bottom of the deque pointed to by d, only the owner thread.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL if the deque is empty
+ */
+extern Task_t *popDeque(Deque_t *d);
+
+/*  Steal a task from the top of the deque pointed to by d, any thread.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL if the deque is empty or the task was taken by another thread
+ */
+extern Task_t *stealDeque(Deque_t *d);
+
+// Number of tasks in the deque pointed to by d, for the owner thread an upper bound (thieves only remove tasks)
+extern size_t sizeDeque(Deque_t *d);
+
+#endif /* __DEQUE_H__ */
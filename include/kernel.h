@@ -0,0 +1,35 @@
+#ifndef __KERNEL_H__
+#define __KERNEL_H__
+
+#include <stddef.h>
+
+// Weighted sum kernel variant
+typedef struct Kernel {
+    const char *name;
+    int (*supported)();
+    long (*weighted_sum)(const long numbers[], size_t n, long base);
+    int dispatched;             // Selected by initKernel() if supported, 0 for a variant slower than the scalar loop
+} Kernel_t;
+
+// Kernel variants, from the most portable to the most specific
+extern const Kernel_t kernels[];
+extern const int n_kernels;
+
+
+/* -------------------- Kernel interface -------------------- */
+
+
+// Select the fastest kernel variant supported by the CPU among the dispatched ones, it is called once at startup
+extern void initKernel();
+
+// Return the name of the selected kernel variant
+extern const char *nameKernel();
+
+/*  Calculate the sum of (base + j) * numbers[j] for j in [0, n) with the selected kernel variant.
+ *  Overflows wrap around, all the variants return the same result of the scalar loop.
+ *
+ *  RETURN VALUE: the weighted sum
+ */
+extern long weightedSum(const long numbers[], size_t n, long base);
+
+#endif /* __KERNEL_H__ */
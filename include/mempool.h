@@ -0,0 +1,51 @@
+#ifndef __MEMPOOL_H__
+#define __MEMPOOL_H__
+
+#include <stddef.h>
+#include <pthread.h>
+#include <utils.h>
+
+// Number of blocks allocated at a time when the pool is empty
+#define MEMPOOL_SLAB 256
+
+// Header of a block, it points to the pool while the block is in use and to the next free block otherwise
+typedef union MemBlock {
+    union MemBlock *next;
+    struct MemPool *pool;
+} MemBlock_t;
+
+// Slab of MEMPOOL_SLAB blocks, kept until the end of the process
+typedef struct MemSlab {
+    struct MemSlab *next;
+} MemSlab_t;
+
+/*  Pool of recycled blocks of 'block_size' bytes.
+ *  Blocks are allocated from the 'local' list under 'mutex', while any thread can free a block lock-free onto the 'remote' list.
+ *  The allocator takes the whole 'remote' list with a single exchange when 'local' is empty, so a freed block is never popped concurrently.
+ */
+typedef struct MemPool {
+    pthread_mutex_t mutex;
+    MemBlock_t *local;
+    MemSlab_t *slabs;
+    size_t block_size;
+    MemBlock_t *remote __attribute__((aligned(CACHE_LINE)));
+} MemPool_t;
+
+// Static initializer of a pool of blocks of 'size' bytes
+#define MEMPOOL_INITIALIZER(size) {PTHREAD_MUTEX_INITIALIZER, NULL, NULL, (size), NULL}
+
+
+/* -------------------- MemPool interface -------------------- */
+
+
+/*  Allocate 'size' bytes from the pool pointed to by p, with malloc() if they do not fit in a block.
+ *
+ *  RETURN VALUE: pointer to the memory on success
+ *                NULL on error (errno is set)
+ */
+extern void *allocMemPool(MemPool_t *p, size_t size);
+
+// Free memory allocated with allocMemPool() pointed to by ptr, from any thread
+extern void freeMemPool(void *ptr);
+
+#endif /* __MEMPOOL_H__ */
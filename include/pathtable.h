@@ -0,0 +1,86 @@
+#ifndef __PATHTABLE_H__
+#define __PATHTABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Address space reserved for the shared memory region of the paths, halved while the reservation fails
+#define PATHTABLE_SIZE ((size_t) 1 << 40)
+
+// Bytes the shared memory region grows at a time as the paths are added, the smallest reservation
+#define PATHTABLE_GROW ((size_t) 64 * 1024 * 1024)
+
+// Initial number of slots of the hash tables of the nodes, doubled when they are half full
+#define PATHTABLE_SLOTS 1024
+
+/*  Node of a path in the shared memory region: the last component of the path and the offset of the node of its directory,
+ *  0 for a path without '/'. The components are joined with '/', so an absolute path starts with an empty component.
+ */
+typedef struct PathNode {
+    uint64_t parent;
+    uint32_t len;               // Length of 'name'
+    uint32_t path_len;          // Length of the whole path
+    char name[];
+} PathNode_t;
+
+/*  Table of the paths of the files in a shared memory region created before fork(), written by the Master thread
+ *  and read by the Collector process. The directories form a trie of components added once, each file is a node
+ *  pointing to its directory, and its ID is the offset of its node in the region. The first 'used' bytes are published.
+ *  The region is a file of 'file_size' bytes mapped in a reservation of 'map_size' bytes, the writer grows the file on 'fd'.
+ *  The hash tables 'dirs' of the directory nodes and 'files' of the file nodes added to be reused, keyed by directory and name,
+ *  and the cache of the last directory are private to the writer.
+ */
+typedef struct PathTable {
+    int fd;
+    char *map;
+    size_t map_size;
+    size_t file_size;
+    size_t *used;
+    uint64_t *dirs;
+    size_t dirs_size;
+    size_t n_dirs;
+    uint64_t *files;
+    size_t files_size;
+    size_t n_files;
+    char *last_dir;
+    size_t last_len;
+    size_t last_size;
+    uint64_t last_node;
+} PathTable_t;
+
+
+/* -------------------- PathTable interface -------------------- */
+
+
+/*  Initialize a table of paths in a shared memory region of at most 'size' bytes, inherited by fork().
+ *  The region grows by PATHTABLE_GROW bytes at a time, the address space reserved is halved until the system grants it.
+ *
+ *  RETURN VALUE: pointer to the new table on success
+ *                NULL on error (errno is set)
+ */
+extern PathTable_t *initPathTable(size_t size);
+
+// Delete a table allocated with initPathTable() pointed to by t, in the calling process
+extern void deletePathTable(PathTable_t *t);
+
+/*  Add 'path' to the table pointed to by t, its directories are added only the first time. If 'reuse' is not zero the path
+ *  is added only the first time too and keeps its ID, otherwise each call adds a new node. Only one thread may add paths.
+ *
+ *  RETURN VALUE: ID of the path on success
+ *                0 on error (errno is set, ENOSPC if the reservation is full)
+ */
+extern uint64_t internPath(PathTable_t *t, const char path[], int reuse);
+
+// Check if 'id' is the ID of a path published in the table pointed to by t
+extern int checkPath(const PathTable_t *t, uint64_t id);
+
+// Return the length of the path of ID 'id' in the table pointed to by t
+extern size_t lengthPath(const PathTable_t *t, uint64_t id);
+
+// Return the number of bytes of the region of the table pointed to by t published so far
+extern size_t usedPathTable(const PathTable_t *t);
+
+// Write the path of ID 'id' in the table pointed to by t to 'buf', without '\0', buf must have lengthPath() bytes
+extern void copyPath(const PathTable_t *t, uint64_t id, char buf[]);
+
+#endif /* __PATHTABLE_H__ */
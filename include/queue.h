@@ -1,46 +1,101 @@
 #ifndef __QUEUE_H__
 #define __QUEUE_H__
 
-// Queue element
+#include <sys/types.h>
+#include <cache.h>
+
+// Bytes of filenames held by a chunk of the queue
+#define QUEUE_CHUNK 65536
+
+// Longest filename, with '\0', popped into a recycled buffer instead of a malloc() one
+#define QUEUE_FILENAME 256
+
+// Initial size of the heap of a priority queue, doubled when it is full
+#define QUEUE_HEAP 1024
+
+// Order in which the filenames are pulled from a queue
+typedef enum QueueOrder {
+    QUEUE_FIFO,         // Order of insertion
+    QUEUE_LARGEST,      // Largest size first, equal sizes in order of insertion
+    QUEUE_SMALLEST      // Smallest size first, equal sizes in order of insertion
+} QueueOrder_t;
+
+// Queue element, stored inline in a chunk, 'key' is the version of the file with its size
 typedef struct Node {
-    char *filename;
-    struct Node *next;
+    FileKey_t key;
+    size_t len;
+    char filename[];
 } Node_t;
 
-// Queue data structure
+// Node in the heap of a priority queue, 'seq' is the number of the insertion
+typedef struct HeapEntry {
+    Node_t *node;
+    size_t seq;
+} HeapEntry_t;
+
+// Chunk of the queue, the nodes between 'begin' and 'end' bytes of 'data' are still in a FIFO queue
+typedef struct Chunk {
+    struct Chunk *next;
+    size_t begin;
+    size_t end;
+    size_t capacity;
+    char data[];
+} Chunk_t;
+
+/*  Queue data structure, an unrolled list of chunks holding the nodes back to back.
+ *  A drained chunk is kept in 'spare' for the next push, so a queue emptied and refilled does not allocate.
+ *  A priority queue pulls the nodes through the binary 'heap' of size 'heap_size', the chunks are freed once it is empty.
+ */
 typedef struct Queue {
-    Node_t *head;
-    Node_t *tail;
+    Chunk_t *head;
+    Chunk_t *tail;
+    Chunk_t *spare;
     size_t qlen; 
+    QueueOrder_t order;
+    HeapEntry_t *heap;
+    size_t heap_size;
+    size_t seq;
 } Queue_t;
 
 
 /* -------------------- Queue interface -------------------- */
 
 
-/*  Initialize an unbounded queue. 
+/*  Initialize an unbounded queue, the filenames are pulled in the order 'order'.
  *
  *  RETURN VALUE: pointer to the new queue on success
  *                NULL on error (errno is set)
  */
-extern Queue_t *initQueue();
+extern Queue_t *initQueue(QueueOrder_t order);
 
 // Delete a queue allocated with initQueue() pointed to by q
 extern void deleteQueue(Queue_t *q);
 
-/*  Insert filename into the queue pointed to by q.
+/*  Insert filename of version 'key' into the queue pointed to by q.
  * 
  *  RETURN VALUE: 0 on success
  *                -1 on error (errno is set)
  */
-extern int pushQueue(Queue_t *q, char filename[]);
+extern int pushQueue(Queue_t *q, char filename[], const FileKey_t *key);
 
-/* Pull filename from the queue.
+/* Pull filename from the queue, its version is stored in 'key'.
+ *  The filename is in a buffer recycled across threads, the caller frees it with freeFilename().
  *
  *  RETURN VALUE: pointer to the filename on success
  *                NULL on empty queue or on error (errno is set)
  */
-extern char *popQueue(Queue_t *q);
+extern char *popQueue(Queue_t *q, FileKey_t *key);
+
+/*  Move all the filenames of the queue pointed to by other at the end of the queue pointed to by q,
+ *  in O(1) if q is a FIFO queue, otherwise each filename is inserted in the heap of q.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set), the queues are not changed
+ */
+extern int appendQueue(Queue_t *q, Queue_t *other);
+
+// Free a filename returned by popQueue(), from any thread
+extern void freeFilename(char filename[]);
 
 // Return the current length of the queue passed as an argument
 extern size_t lengthQueue(Queue_t *q);
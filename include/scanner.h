@@ -0,0 +1,21 @@
+#ifndef __SCANNER_H__
+#define __SCANNER_H__
+
+#include <queue.h>
+#include <stream.h>
+
+
+/* -------------------- Scanner interface -------------------- */
+
+
+/*  Search recursively inside 'dirname' directory, valid files, and put them in the 'requests' queue,
+ *  using 'n_threads' scanner threads that share the directories still to be read.
+ *  If 'stream' is not NULL the files are appended to it after each directory instead, while the scan is running.
+ *  Pathnames longer than 'pathname_max' are ignored, warnings and errors are reported with 'progname'.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set, ECANCELED if the consumer has cancelled 'stream')
+ */
+extern int scanDirectory(const char dirname[], Queue_t *requests, FileStream_t *stream, size_t n_threads, size_t pathname_max, const char progname[]);
+
+#endif /* __SCANNER_H__ */
@@ -0,0 +1,77 @@
+#ifndef __SHMRING_H__
+#define __SHMRING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utils.h>
+
+// Values of 'consumer_sleeping' other than 0 (awake): woken up by any result or only by a half full ring
+#define RING_SLEEPING 1
+#define RING_LAZY 2
+
+// Result record in the ring, 'seq' tells whether the slot is free or published for the consumer
+typedef struct RingSlot {
+    size_t seq;
+    long result;
+    uint64_t id;                // ID of the file in the table of the paths
+    uint64_t submission;        // Sequence number of the submission of the file by the Master thread
+} RingSlot_t;
+
+/*  Bounded MPSC ring of results in a shared memory region created before fork().
+ *  Producers are the Worker threads, the consumer is the Collector process.
+ *  The consumer is woken up by 'efd' (eventfd), producers waiting for a free slot by a futex on 'space_seq'.
+ */
+typedef struct ShmRing {
+    size_t tail __attribute__((aligned(CACHE_LINE)));
+    unsigned int space_seq;
+    unsigned int space_waiters;
+    size_t head __attribute__((aligned(CACHE_LINE)));
+    int consumer_sleeping;
+    int efd __attribute__((aligned(CACHE_LINE)));
+    size_t mask;
+    size_t map_size;
+    RingSlot_t slots[];
+} ShmRing_t;
+
+
+/* -------------------- ShmRing interface -------------------- */
+
+
+/*  Initialize a ring of 'n_slots' slots (a power of 2, at least 2) in a shared memory region, inherited by fork().
+ *
+ *  RETURN VALUE: pointer to the new ring on success
+ *                NULL on error (errno is set)
+ */
+extern ShmRing_t *initShmRing(size_t n_slots);
+
+// Delete a ring allocated with initShmRing() pointed to by r, in the calling process
+extern void deleteShmRing(ShmRing_t *r);
+
+/*  Insert the 'result' of the submission number 'submission' of the file of ID 'id' into the ring pointed to by r,
+ *  wait if the ring is full. Safe to call from many threads.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+extern int pushShmRing(ShmRing_t *r, uint64_t id, uint64_t submission, long result);
+
+/*  Pull a result from the ring pointed to by r, with the ID of its file and its submission number.
+ *  Only one thread may pull from the ring.
+ *
+ *  RETURN VALUE: 1 on success
+ *                0 on empty ring
+ */
+extern int popShmRing(ShmRing_t *r, uint64_t *id, uint64_t *submission, long *result);
+
+/*  Announce that the consumer is about to wait on 'efd', producers will write to it.
+ *  If 'lazy' is not zero producers write to 'efd' only when the ring is half full, the consumer must wait with a timeout.
+ *
+ *  RETURN VALUE: 1 if the consumer can wait
+ *                0 if the ring is not empty, the consumer must not wait
+ */
+extern int sleepShmRing(ShmRing_t *r, int lazy);
+
+// The consumer is awake: stop the wake ups and reset 'efd'
+extern void awakeShmRing(ShmRing_t *r);
+
+#endif /* __SHMRING_H__ */
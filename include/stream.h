@@ -0,0 +1,72 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <time.h>
+#include <pthread.h>
+#include <queue.h>
+
+/*  Stream of filenames from the scanner threads (producers) to the Master thread (consumer).
+ *  Filenames are appended in batches, a queue at a time, and popped one by one.
+ */
+typedef struct FileStream {
+    Queue_t *files;
+    size_t capacity;            // Producers wait while the stream holds at least 'capacity' filenames, 0 for no limit
+    int closed;                 // Set by the producers at the end of the stream
+    int cancelled;              // Set by the consumer when it stops popping
+    int error_number;           // Error of the producers, 0 if none
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} FileStream_t;
+
+
+/* -------------------- Stream interface -------------------- */
+
+
+/*  Initialize a stream holding at most about 'capacity' filenames, 0 for no limit, pulled in the order 'order'.
+ *  With a priority order, a filename is pulled before the ones appended together with it or after it.
+ *
+ *  RETURN VALUE: pointer to the new stream on success
+ *                NULL on error (errno is set)
+ */
+extern FileStream_t *initStream(size_t capacity, QueueOrder_t order);
+
+// Delete a stream allocated with initStream() pointed to by s, the remaining filenames are deleted
+extern void deleteStream(FileStream_t *s);
+
+/*  Move all the filenames of the queue 'files' at the end of the stream pointed to by s, waiting while the stream is full.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set to ECANCELED if the consumer has cancelled the stream)
+ */
+extern int appendStream(FileStream_t *s, Queue_t *files);
+
+/*  Pull filename from the stream, waiting while it is empty, its version is stored in 'key'.
+ *
+ *  RETURN VALUE: pointer to the filename on success
+ *                NULL at the end of the stream (errno is set to 0) or on error (errno is set)
+ */
+extern char *popStream(FileStream_t *s, FileKey_t *key);
+
+/*  Pull filename from the stream, its version is stored in 'key', waiting at most until the absolute time 'abstime' of the CLOCK_MONOTONIC clock.
+ *
+ *  RETURN VALUE: pointer to the filename on success
+ *                NULL at the end of the stream (errno is set to 0), on timeout (errno is set to ETIMEDOUT) or on error (errno is set)
+ */
+extern char *timedPopStream(FileStream_t *s, FileKey_t *key, const struct timespec *abstime);
+
+/*  End the stream pointed to by s, 'error_number' is the error of the producers (0 if none).
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+extern int closeStream(FileStream_t *s, int error_number);
+
+/*  Cancel the stream pointed to by s, the producers waiting on it fail with ECANCELED.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+extern int cancelStream(FileStream_t *s);
+
+#endif /* __STREAM_H__ */
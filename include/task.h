@@ -0,0 +1,70 @@
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <cache.h>
+
+// Read the file until the end
+#define TASK_TO_EOF ((size_t) -1)
+
+// File shared by the tasks in which it is split
+typedef struct File {
+    char *filename;
+    uint64_t id;                // ID of the file in the table of the paths
+    uint64_t submission;        // Sequence number of the submission of the file, orders the results of the same ID
+    CacheEntry_t *entry;        // Entry of the file in the cache of the results, NULL if none
+    size_t pending;
+    long result;
+    int failed;
+    pthread_mutex_t mutex;
+} File_t;
+
+// Task: 'nelem' numbers of 'file' starting from the number of index 'offset'
+typedef struct Task {
+    File_t *file;
+    off_t offset;
+    size_t nelem;
+} Task_t;
+
+
+/* -------------------- Task interface -------------------- */
+
+
+/*  Initialize the file of ID 'id' and submission number 'submission' that will be split in 'n_tasks' tasks, 'filename' is returned by popQueue() and owned by the file.
+ *  'entry' is the entry of the file in the cache of the results, filled with its result, NULL if none.
+ *  'result' is the result of the bytes of the file that are not read, the partial results of the tasks are added to it.
+ *
+ *  RETURN VALUE: pointer to the new file on success
+ *                NULL on error (errno is set)
+ */
+extern File_t *initFile(char filename[], uint64_t id, uint64_t submission, CacheEntry_t *entry, long result, size_t n_tasks);
+
+// Delete a file allocated with initFile() pointed to by f, 'filename' is freed with freeFilename()
+extern void deleteFile(File_t *f);
+
+/*  Initialize a task of 'nelem' numbers of 'file' starting from the number of index 'offset'.
+ *
+ *  RETURN VALUE: pointer to the new task on success
+ *                NULL on error (errno is set)
+ */
+extern Task_t *initTask(File_t *file, off_t offset, size_t nelem);
+
+/*  Merge the 'partial' result of the task pointed to by t into its file, 'failed' marks the file as failed.
+ *  The task is freed.
+ *
+ *  RETURN VALUE: pointer to the file if t was its last pending task, the caller must delete it
+ *                NULL otherwise
+ */
+extern File_t *completeTask(Task_t *t, long partial, int failed);
+
+// Delete a task allocated with initTask() pointed to by t without executing it, the file is marked as failed
+extern void deleteTask(Task_t *t);
+
+/*  Cancel 'n_tasks' tasks of the file pointed to by f that will never be created, the file is marked as failed.
+ *  The file is deleted if it has no more pending tasks.
+ */
+extern void cancelTasks(File_t *f, size_t n_tasks);
+
+#endif /* __TASK_H__ */
@@ -3,13 +3,38 @@
 
 #include <pthread.h>
 #include <concurrentqueue.h>
+#include <deque.h>
+#include <shmring.h>
 
-// Thread pool data structure
+// Engine used by Worker threads to read files
+typedef enum ReadEngine {
+    ENGINE_AUTO,    // mmap() for large files, fread() otherwise
+    ENGINE_STDIO,   // fread()
+    ENGINE_MMAP,    // mmap()
+    ENGINE_URING    // io_uring, several files in flight for each Worker thread
+} ReadEngine_t;
+
+// Scheduling of the tasks among the Worker threads
+typedef enum Scheduler {
+    SCHEDULER_SHARED,   // A queue shared by all the Worker threads
+    SCHEDULER_RR,       // Work stealing, files assigned round-robin to the Worker threads
+    SCHEDULER_LOCALITY  // Work stealing, files of the same directory assigned to the same Worker thread
+} Scheduler_t;
+
+/*  Thread pool data structure.
+ *  With work stealing every Worker thread has an inbox filled by the Master thread and a deque of its own,
+ *  idle Worker threads steal tasks from the deques of the others.
+ */
 typedef struct Threadpool {
     int pool_size;
+    size_t n_workers;
+    size_t chunk_nelem;
+    Scheduler_t scheduler;
+    size_t next_worker;
     pthread_t *worker_threads;
     ConcurrentQueue_t *tasks;
-    pthread_mutex_t *collector_fd_mutex;
+    ConcurrentQueue_t **inboxes;
+    Deque_t **deques;
 } Threadpool_t;
 
 
@@ -17,13 +42,18 @@ typedef struct Threadpool {
 
 
 /*  Create a new thread pool with 'pool_size' Worker threads and internal queue of size 'queue_size'. 
- *  Worker threads send results to file descriptor 'collector_fd'.
- *  The variable 'collector_fd_mutex' ensures correct synchronization between threads.
+ *  Tasks are scheduled with 'scheduler', with work stealing every Worker thread has an inbox and a deque of size 'queue_size'.
+ *  Files larger than 'chunk_size' bytes are split in tasks of 'chunk_size' bytes, 0 disables the splitting.
+ *  Worker threads read files with the 'engine' read engine, with ENGINE_URING each one keeps up to 'uring_depth' files in flight
+ *  and falls back to ENGINE_AUTO if it cannot create its io_uring instance. If 'ring' is not NULL Worker threads publish results
+ *  in the shared memory ring and 'collector_fds' may be NULL, otherwise the i-th Worker thread sends results to its own
+ *  channel 'collector_fds[i]' and closes it when it terminates. The channels are closed also on error.
  *
  *  RETURN VALUE: pointer to the new thread pool on success
  *                NULL on error (errno is set)
  */
-extern Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, int collector_fd, pthread_mutex_t *collector_fd_mutex);
+extern Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, size_t chunk_size, ReadEngine_t engine, size_t uring_depth,
+                                    Scheduler_t scheduler, int collector_fds[], ShmRing_t *ring);
 
 /*  Initiate an orderly shutdown of the thread pool 'pool' in which previously submitted tasks are executed.
  *
@@ -32,11 +62,15 @@ extern Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, int col
  */
 extern int shutdownThreadPool(Threadpool_t *pool);
 
-/*  Submit a new 'filename' for execution to the thread pool 'pool'. 
+/*  Submit a new 'filename' of 'size' bytes, of ID 'id' in the table of the paths and of submission number 'submission'
+ *  for execution to the thread pool 'pool', its result is sent with the ID and the submission number.
+ *  The thread pool takes ownership of 'filename', returned by popQueue(), also on error.
+ *  The first 'offset' bytes of the file have the result 'result' and are not read, only the numbers from
+ *  the index offset / sizeof(long) are. If 'entry' is not NULL the result is stored in the entry of the file in the cache of the results.
  *
  *  RETURN VALUE: 0 on success
  *                -1 on error (errno is set)
  */
-extern int submitThreadPool(Threadpool_t *pool, char filename[]);
+extern int submitThreadPool(Threadpool_t *pool, char filename[], uint64_t id, uint64_t submission, off_t size, off_t offset, long result, CacheEntry_t *entry);
 
 #endif /* __THREADPOOL_H__ */
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef __URING_H__
+#define __URING_H__
+
+#include <stddef.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/*  io_uring instance driven with the raw system calls, used by a single thread.
+ *  The submission queue entries are filled in place and handed to the kernel in batches by enterUring().
+ */
+typedef struct Uring {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned sqe_tail;          // Entries filled by getSqeUring(), published to the kernel by enterUring()
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+} Uring_t;
+
+
+/* -------------------- Uring interface -------------------- */
+
+
+/*  Initialize the io_uring instance pointed to by u with 'entries' submission queue entries,
+ *  the kernel must support the IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_READ_FIXED and IORING_OP_CLOSE operations.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set, EOPNOTSUPP if an operation is not supported)
+ */
+extern int initUring(Uring_t *u, unsigned entries);
+
+// Delete the io_uring instance initialized with initUring() pointed to by u
+extern void deleteUring(Uring_t *u);
+
+/*  Register the 'n' buffers 'iov' in the io_uring instance pointed to by u, for IORING_OP_READ_FIXED.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+extern int registerBuffersUring(Uring_t *u, const struct iovec iov[], unsigned n);
+
+/*  Get a zeroed submission queue entry of the io_uring instance pointed to by u, to fill before the next enterUring().
+ *
+ *  RETURN VALUE: pointer to the entry on success
+ *                NULL if the submission queue is full
+ */
+extern struct io_uring_sqe *getSqeUring(Uring_t *u);
+
+/*  Submit the entries filled since the last call and wait for at least 'min_complete' completions.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+extern int enterUring(Uring_t *u, unsigned min_complete);
+
+/*  Get the oldest completion queue entry of the io_uring instance pointed to by u, without waiting.
+ *
+ *  RETURN VALUE: pointer to the entry, valid until seenUring()
+ *                NULL if there are no completions
+ */
+extern struct io_uring_cqe *peekUring(Uring_t *u);
+
+// Release the completion queue entry returned by peekUring()
+extern void seenUring(Uring_t *u);
+
+#endif /* __URING_H__ */
@@ -5,6 +5,10 @@
 #include <stdio.h>
 #include <errno.h>
 #include <pthread.h>
+#include <sys/uio.h>
+
+// Size of a cache line, indexes written by different threads are kept on different lines
+#define CACHE_LINE 64
 
 #define SYSCALL_EXIT(progname, message, syscall)                        \
     if ((syscall) == -1) {                                              \
@@ -74,4 +78,27 @@ extern int readn(int fd, void *buf, size_t n);
  */
 extern int writen(int fd, void *buf, size_t n);
 
+/*  Write the 'iovcnt' buffers described by 'iov' to file descriptor 'fd', 'iov' is modified.
+ *
+ *  RETURN VALUE: number of bytes written on success
+ *                -1 on error (errno is set)
+ */
+extern ssize_t writevn(int fd, struct iovec *iov, int iovcnt);
+
+/*  Write 'n' byte from the buffer starting at 'buf' to UNIX socket 'fd', passing the file descriptor 'passed_fd' with them.
+ *
+ *  RETURN VALUE: n on success
+ *                -1 on error (errno is set)
+ */
+extern int sendfd(int fd, void *buf, size_t n, int passed_fd);
+
+/*  Read 'n' byte from UNIX socket 'fd' into the buffer starting at 'buf'.
+ *  The file descriptor passed with them is stored in 'passed_fd', -1 if there is none.
+ *
+ *  RETURN VALUE: n on success
+ *                0 indicates end of file
+ *                -1 on error (errno is set)
+ */
+extern int recvfd(int fd, void *buf, size_t n, int *passed_fd);
+
 #endif /* __UTILS_H__ */
@@ -0,0 +1,52 @@
+#ifndef __WATCH_H__
+#define __WATCH_H__
+
+#include <stddef.h>
+#include <sys/inotify.h>
+#include <queue.h>
+
+// Events watched in each directory: the files written and closed, the files and directories moved in, the new directories
+// and the move of the directory itself
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MOVE_SELF | IN_ONLYDIR)
+
+// Size of the buffer of the inotify events, a single read() returns many of them
+#define WATCH_BUF_SIZE (64 * 1024)
+
+/*  Directory tree watched with inotify, used by the Master thread only.
+ *  'dirs' holds the pathname of the directory of each watch descriptor, NULL if it is not watched.
+ */
+typedef struct Watch {
+    int fd;
+    char *dirname;
+    char **dirs;
+    size_t dirs_size;
+    size_t pathname_max;
+    const char *progname;
+    char *buffer;
+} Watch_t;
+
+
+/* -------------------- Watch interface -------------------- */
+
+
+/*  Initialize the watch of the directory tree 'dirname' and of its subdirectories.
+ *  Pathnames longer than 'pathname_max' are ignored, warnings are reported with 'progname'.
+ *
+ *  RETURN VALUE: pointer to the new watch on success
+ *                NULL on error (errno is set)
+ */
+extern Watch_t *initWatch(const char dirname[], size_t pathname_max, const char progname[]);
+
+// Delete a watch allocated with initWatch() pointed to by w
+extern void deleteWatch(Watch_t *w);
+
+/*  Wait at most 'timeout' ms for the events of the watch pointed to by w and put the files written or moved in the tree
+ *  in the 'requests' queue. The new directories are watched and the files already in them are put in the queue too.
+ *  If the kernel has dropped events the whole tree is read again.
+ *
+ *  RETURN VALUE: number of files put in the queue on success, 0 also if interrupted by a signal handler
+ *                -1 on error (errno is set)
+ */
+extern int readWatch(Watch_t *w, Queue_t *requests, int timeout);
+
+#endif /* __WATCH_H__ */
@@ -0,0 +1,375 @@
+#define _GNU_SOURCE // st_mtim, strdup(), flock()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <cache.h>
+#include <utils.h>
+
+// Bytes of a cache file of 'capacity' entries
+#define CACHE_FILE_SIZE(capacity) (sizeof(CacheHeader_t) + (capacity) * sizeof(CacheEntry_t))
+
+// Store the version of the file of status 'statbuf' in 'key'
+void keyFile(FileKey_t *key, const struct stat *statbuf) {
+    key->dev = statbuf->st_dev;
+    key->ino = statbuf->st_ino;
+    key->size = statbuf->st_size;
+    key->mtime_sec = statbuf->st_mtim.tv_sec;
+    key->mtime_nsec = statbuf->st_mtim.tv_nsec;
+}
+
+// Hash of the device and inode of 'key', the versions of a file share the same entry
+static size_t hash_key(const FileKey_t *key) {
+    uint64_t hash = key->ino ^ ((key->dev << 32) | (key->dev >> 32));
+
+    hash *= 0x9E3779B97F4A7C15ULL;
+
+    return hash ^ (hash >> 29);
+}
+
+// Checksum of the 'n' bytes of 'buffer', never 0
+static uint64_t checksum(const unsigned char buffer[], size_t n) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (size_t i = 0; i < n; i++)
+        hash = (hash ^ buffer[i]) * 0x100000001B3ULL;
+
+    return (hash != 0) ? hash : 1;
+}
+
+/*  Read the first CACHE_SAMPLE bytes of 'filename' of 'size' bytes into 'buffer', all of them if the file is smaller.
+ *
+ *  RETURN VALUE: number of bytes read on success
+ *                -1 on error or if the file is shorter than 'size' bytes
+ */
+static ssize_t read_sample(const char filename[], off_t size, unsigned char buffer[]) {
+    size_t n = (size < CACHE_SAMPLE) ? (size_t) size : CACHE_SAMPLE;
+    int fd, ret;
+
+    if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) == -1)
+        return -1;
+
+    ret = readn(fd, buffer, n);
+    close(fd);
+
+    return ((n == 0) || (ret > 0)) ? (ssize_t) n : -1;
+}
+
+// Check if the cache file opened on 'fd' of 'size' bytes holds a valid table
+static int valid_file(int fd, off_t size) {
+    CacheHeader_t header;
+
+    if ((size < (off_t) sizeof(CacheHeader_t)) || (pread(fd, &header, sizeof(CacheHeader_t), 0) != sizeof(CacheHeader_t)))
+        return 0;
+
+    return (header.magic == CACHE_MAGIC) && (header.capacity != 0) && ((header.capacity & (header.capacity - 1)) == 0) &&
+           (header.count <= header.capacity) && ((uint64_t) size == CACHE_FILE_SIZE(header.capacity));
+}
+
+/*  Open the cache in the file 'pathname', created if it does not exist or if it is not a valid cache.
+ *  If 'refresh' is not zero every lookup misses and the results are stored again,
+ *  'incremental' is the recompute of the files that have grown.
+ *
+ *  RETURN VALUE: pointer to the cache on success
+ *                NULL on error (errno is set, EWOULDBLOCK if another process is using the cache)
+ */
+ResultCache_t *openCache(const char pathname[], int refresh, Incremental_t incremental) {
+    // Check pathname
+    if (pathname == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Allocate cache data structure
+    ResultCache_t *c;
+
+    if ((c = malloc(sizeof(ResultCache_t))) == NULL)
+        return NULL;
+
+    if ((c->pathname = strdup(pathname)) == NULL) {
+        free(c);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Open and lock the file, a single process at a time uses the cache
+    struct stat statbuf;
+
+    if (((c->fd = open(pathname, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1) || (flock(c->fd, LOCK_EX | LOCK_NB) == -1) ||
+        (fstat(c->fd, &statbuf) == -1)) {
+        int errsv = errno;
+        if (c->fd != -1) close(c->fd);
+        free(c->pathname);
+        free(c);
+        errno = errsv;
+        return NULL;
+    }
+
+    // Start from an empty table if the file is new or not valid
+    int empty = !valid_file(c->fd, statbuf.st_size);
+
+    if (empty) {
+        statbuf.st_size = CACHE_FILE_SIZE(CACHE_SLOTS);
+
+        if ((ftruncate(c->fd, 0) == -1) || (ftruncate(c->fd, statbuf.st_size) == -1)) {
+            int errsv = errno;
+            close(c->fd);
+            free(c->pathname);
+            free(c);
+            errno = errsv;
+            return NULL;
+        }
+    }
+
+    c->map_size = statbuf.st_size;
+
+    if ((c->header = mmap(NULL, c->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0)) == MAP_FAILED) {
+        int errsv = errno;
+        close(c->fd);
+        free(c->pathname);
+        free(c);
+        errno = errsv;
+        return NULL;
+    }
+
+    if (empty) {
+        c->header->magic = CACHE_MAGIC;
+        c->header->capacity = CACHE_SLOTS;
+        c->header->count = 0;
+        c->header->hits = 0;
+        c->header->misses = 0;
+        c->header->grown = 0;
+        c->header->run = 0;
+    }
+
+    // Init variables, a new run starts
+    c->header->run++;
+    c->entries = (CacheEntry_t*) (c->header + 1);
+    c->refresh = refresh;
+    c->incremental = incremental;
+    c->start = time(NULL);
+    c->hits = 0;
+    c->grown = 0;
+    c->misses = 0;
+    c->overflow = 0;
+
+    // Return pointer to the cache
+    return c;
+}
+
+/*  Look up 'filename' of version 'key' in the cache pointed to by c, only the Master thread may look up.
+ *  On a miss the entry of the file is reserved and stored in 'entry', NULL if the file cannot be cached,
+ *  the entry is filled with storeCache() once the result is calculated.
+ *
+ *  RETURN VALUE: 1 on a hit, the result is stored in 'result'
+ *                0 on a miss, the first 'offset' bytes of the file have the result stored in 'result'
+ *                  (0 and 0 unless the file has grown and the cache is incremental)
+ */
+int lookupCache(ResultCache_t *c, const char filename[], const FileKey_t *key, long *result, off_t *offset, CacheEntry_t **entry) {
+    size_t mask = c->header->capacity - 1, i = hash_key(key) & mask, n;
+    CacheEntry_t *e = NULL;
+    uint32_t state = CACHE_EMPTY;
+
+    *entry = NULL;
+    *offset = 0;
+    *result = 0;
+
+    // Linear probing until the entry of the file or an empty one, a damaged file may have none
+    for (n = 0; n <= mask; n++) {
+        e = &c->entries[i];
+        state = __atomic_load_n(&e->state, __ATOMIC_ACQUIRE);
+
+        if (state == CACHE_EMPTY) break;
+
+        if ((e->key.dev == key->dev) && (e->key.ino == key->ino)) {
+            if (!c->refresh && (state == CACHE_VALID) && (e->key.size == key->size) && (e->key.mtime_sec == key->mtime_sec) &&
+                (e->key.mtime_nsec == key->mtime_nsec)) {
+                *result = e->result;
+                e->run = c->header->run;
+                c->hits++;
+                return 1;
+            }
+
+            break;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    if (n > mask) {
+        c->misses++;
+        return 0;
+    }
+
+    unsigned char sample[CACHE_SAMPLE];
+    ssize_t sample_size = -1;
+
+    // The file has grown since its result was stored, only the appended bytes are read: the new numbers start
+    // from the index e->key.size / sizeof(long) and the bytes of an incomplete last number are read again
+    if ((state == CACHE_VALID) && !c->refresh && (c->incremental != INCREMENTAL_OFF) && (key->size > e->key.size)) {
+        if (c->incremental == INCREMENTAL_VERIFY)
+            sample_size = read_sample(filename, key->size, sample);
+
+        // The start of the file must be the same, a file rewritten with more bytes is read from the start
+        if ((c->incremental == INCREMENTAL_APPEND) || ((sample_size != -1) && (e->sample ==
+            checksum(sample, (e->key.size < CACHE_SAMPLE) ? (size_t) e->key.size : CACHE_SAMPLE)))) {
+            *offset = e->key.size;
+            *result = e->result;
+        }
+    }
+
+    if (*offset != 0)
+        c->grown++;
+    else
+        c->misses++;
+
+    // The same file is being calculated, or it was modified in the last second and a later write
+    // with the same modification time would go unnoticed
+    if (((state == CACHE_PENDING) && (e->run == c->header->run)) || (key->mtime_sec >= c->start - 1))
+        return 0;
+
+    // A new entry, the table is kept at most three quarters full until the next compaction
+    if (state == CACHE_EMPTY) {
+        if (4 * (c->header->count + 1) > 3 * c->header->capacity) {
+            c->overflow++;
+            return 0;
+        }
+
+        c->header->count++;
+    }
+
+    // Reserve the entry for the version of the file
+    e->key = *key;
+    e->sample = 0;
+    e->run = c->header->run;
+
+    if (c->incremental == INCREMENTAL_VERIFY) {
+        if (sample_size == -1) sample_size = read_sample(filename, key->size, sample);
+        if (sample_size != -1) e->sample = checksum(sample, sample_size);
+    }
+
+    __atomic_store_n(&e->state, CACHE_PENDING, __ATOMIC_RELAXED);
+
+    *entry = e;
+
+    return 0;
+}
+
+// Store 'result' in the entry reserved by lookupCache() pointed to by e, from any thread
+void storeCache(CacheEntry_t *e, long result) {
+    if (e != NULL) {
+        e->result = result;
+        __atomic_store_n(&e->state, CACHE_VALID, __ATOMIC_RELEASE);
+    }
+}
+
+// Check if the entry pointed to by e survives the compaction of the cache pointed to by c
+static int live_entry(const ResultCache_t *c, const CacheEntry_t *e) {
+    return (e->state == CACHE_VALID) && ((uint32_t) (c->header->run - e->run) < CACHE_MAX_AGE);
+}
+
+/*  Rewrite the cache pointed to by c with the 'n_live' live entries in a table of 'capacity' entries.
+ *  The new table is written to a temporary file renamed over the old one.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+static int compact(ResultCache_t *c, size_t capacity, size_t n_live) {
+    size_t len = strlen(c->pathname), map_size = CACHE_FILE_SIZE(capacity);
+    char tmp_pathname[len + sizeof(".tmp")];
+    CacheHeader_t *header;
+    int fd;
+
+    memcpy(tmp_pathname, c->pathname, len);
+    memcpy(tmp_pathname + len, ".tmp", sizeof(".tmp"));
+
+    if ((fd = open(tmp_pathname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1)
+        return -1;
+
+    if ((ftruncate(fd, map_size) == -1) ||
+        ((header = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)) {
+        int errsv = errno;
+        close(fd);
+        unlink(tmp_pathname);
+        errno = errsv;
+        return -1;
+    }
+
+    *header = *c->header;
+    header->capacity = capacity;
+    header->count = n_live;
+
+    // Insert the live entries in the new table
+    CacheEntry_t *entries = (CacheEntry_t*) (header + 1);
+
+    for (size_t i = 0; i < c->header->capacity; i++) {
+        if (live_entry(c, &c->entries[i])) {
+            size_t j = hash_key(&c->entries[i].key) & (capacity - 1);
+
+            while (entries[j].state != CACHE_EMPTY) j = (j + 1) & (capacity - 1);
+
+            entries[j] = c->entries[i];
+        }
+    }
+
+    munmap(header, map_size);
+
+    if ((close(fd) == -1) || (rename(tmp_pathname, c->pathname) == -1)) {
+        int errsv = errno;
+        unlink(tmp_pathname);
+        errno = errsv;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*  Close the cache pointed to by c, compacting its file if the entries not used for CACHE_MAX_AGE runs
+ *  are at least a quarter of the entries or if the table must grow. The cache is freed also on error.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int closeCache(ResultCache_t *c) {
+    // Check cache pointer
+    if (c == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int ret = 0;
+    size_t n_live = 0, capacity = CACHE_SLOTS;
+
+    c->header->hits += c->hits;
+    c->header->grown += c->grown;
+    c->header->misses += c->misses;
+
+    // Count the entries kept by a compaction, the entries of failed files are never filled
+    for (size_t i = 0; i < c->header->capacity; i++)
+        n_live += live_entry(c, &c->entries[i]);
+
+    // The next run also stores the files that did not fit in the table
+    while (2 * (n_live + c->overflow) > capacity) capacity *= 2;
+
+    if ((capacity > c->header->capacity) || (4 * (c->header->count - n_live) >= c->header->count + 1))
+        ret = compact(c, capacity, n_live);
+
+    int errsv = errno;
+
+    munmap(c->header, c->map_size);
+    close(c->fd);
+    free(c->pathname);
+    free(c);
+
+    errno = errsv;
+    return ret;
+}
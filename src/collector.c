@@ -1,74 +1,1550 @@
+#define _GNU_SOURCE // mkstemp(), pread()
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/epoll.h>
 #include <utils.h>
+#include <shmring.h>
+#include <pathtable.h>
 #include <collector.h>
 
-// Result of a filename
-typedef struct Result {
-    char *filename;
-    long result;
-} Result_t;
+// Maximum number of events returned by epoll_wait()
+#define MAX_EVENTS 64
+
+// Initial size of the arrays of results, doubled when they are full
+#define RESULTS_SIZE 1024
+
+// Initial number of slots of the hash table of the last result of each path, doubled when it is half full
+#define REPLACE_SLOTS 1024
+
+// Minimum number of new results sorted with the radix sort, fewer results are sorted with quicksort
+#define RADIX_MIN 4096
+
+// Bits of the digit of a radix sort pass, 6 passes of 11 bits cover a 64-bit key with counters that fit in the cache
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+// Minimum number of results sorted or printed by more threads, fewer results are sorted and printed by the Collector thread
+#define PARALLEL_MIN 65536
+
+// Number of results formatted by a thread at a time, the lines of all the threads are written in order before the next ones
+#define FORMAT_BLOCK 16384
+
+// Size of the buffer of the output, flushed at the end of each print or when it is full
+#define OUTPUT_BUFFER (1024 * 1024)
+
+// Maximum number of characters of a long in decimal, sign included
+#define LONG_DIGITS_MAX 20
+
+// Size of the buffers used to write and read a run of spilled results, it holds any record
+#define RUN_BUFFER (2 * BATCH_MAX)
+
+// Size of the header of a record of a run: the result (long) and the length of the filename (int)
+#define RUN_HEADER (sizeof(long) + sizeof(int))
+
+// Memory accounted for a result: its result, the ID of its file and its slot in the order
+#define RESULT_MEMORY (sizeof(long) + sizeof(uint64_t) + sizeof(uint32_t))
+
+// Maximum time in milliseconds a result waits in the ring while results keep coming, as the batches of the Worker threads
+#define RING_LATENCY 10
+
+// Time in milliseconds between two checks of the end of a snapshot, while another one is waiting for it
+#define SNAPSHOT_POLL 10
+
+/*  Run of results spilled to an unlinked temporary file, sorted in ascending order, with the number of results
+ *  and the total length of their filenames (including '\0'). Each record is the result (long), the length of the filename (int)
+ *  and the filename (without '\0'), so the merge does not read the table of the paths.
+ */
+typedef struct Run {
+    int fd;
+    off_t size;
+    size_t n_results;
+    size_t names_size;
+} Run_t;
+
+// Sequential reader of a run, 'filename' points to the filename of the current record in 'buf'
+typedef struct RunReader {
+    int fd;
+    off_t offset;
+    off_t size;
+    char *buf;
+    size_t len;
+    size_t pos;
+    long result;
+    char *filename;
+    size_t filename_len;
+} RunReader_t;
+
+// Source of the k-way merge, a run or the results in memory, with its current result
+typedef struct MergeSource {
+    long result;
+    size_t source;
+} MergeSource_t;
+
+// Sort key of a result: the result with the sign bit flipped, so it orders as unsigned, and its index in the arrays of results
+typedef struct SortKey {
+    uint64_t key;
+    uint32_t index;
+} SortKey_t;
+
+// Sort shared by the threads: the 'n' results whose indexes are in 'run' are sorted in 'n_threads' chunks merged in rounds
+typedef struct ParallelSort {
+    uint32_t *run;
+    size_t n;
+    size_t n_threads;
+    pthread_barrier_t barrier;
+} ParallelSort_t;
+
+// Print shared by the threads: the 'n' results whose indexes are in 'run' are formatted in blocks of FORMAT_BLOCK results
+typedef struct ParallelPrint {
+    const uint32_t *run;
+    size_t n;
+    size_t n_threads;
+    pthread_barrier_t barrier;
+    struct PrintThread *threads;
+    struct iovec *iov;
+} ParallelPrint_t;
+
+// Thread of a parallel sort, 'id' from 0 (the Collector thread)
+typedef struct SortThread {
+    ParallelSort_t *sort;
+    size_t id;
+} SortThread_t;
+
+// Thread of a parallel print, it formats the lines of a block in a buffer while the lines of the previous block are written
+typedef struct PrintThread {
+    ParallelPrint_t *print;
+    size_t id;
+    char *buf[2];
+    size_t len[2];
+    size_t size[2];
+} PrintThread_t;
+
+// Connection socket with the Master process
+static int sfd = -1;
+
+// epoll instance multiplexing the Master connection and the Worker channels
+static int epfd = -1;
+
+// Table of the paths of the files shared by the Master process, the results refer to their files by ID
+static PathTable_t *paths = NULL;
+
+/*  Results stored in arrays of size 'results_size', grown while the results come: the result of each file ('keys')
+ *  and the ID of the file ('ids'), in order of arrival.
+ *  The results are sorted through the permutation 'order' of their indexes, the first 'results_sorted' in ascending order.
+ */
+static long *keys = NULL;
+static uint64_t *ids = NULL;
+static uint32_t *order = NULL;
+static size_t results_index = 0;
+static size_t results_size = 0;
+static size_t results_sorted = 0;
+
+/*  With 'replace' set by the Master process a new result of a file replaces its previous one. The index and the submission number
+ *  of the last result of each file are kept in an open addressing hash table of size 'slots_size' keyed by ID ('slot_ids', 0 for
+ *  a free slot), the 'n_replaced' results replaced are marked with ID 0 and dropped before the next print.
+ */
+static int replace = 0;
+static uint64_t *slot_ids = NULL;
+static uint64_t *slot_submissions = NULL;
+static uint32_t *slot_indexes = NULL;
+static size_t slots_size = 0;
+static size_t n_slots = 0;
+static size_t n_replaced = 0;
+
+// Number of results kept: 0 all of them, k > 0 the k smallest, k < 0 the -k largest
+// With a limit 'order' is a binary heap of at most k results, its root is the first result to drop
+static int top_k = 0;
+
+// Copy of the heap of results sorted at each print, of size 'top_size'
+static uint32_t *top_buffer = NULL;
+static size_t top_size = 0;
+
+// Buffers of size 'merge_size' for the results being merged into the sorted ones, and for the sort keys
+static uint32_t *merge_buffer = NULL;
+static SortKey_t *sort_keys = NULL;
+static SortKey_t *sort_tmp = NULL;
+static size_t merge_size = 0;
+
+// Number of threads sorting and printing the results, set by the Master process
+static int n_threads = 1;
+
+// Memory cap of the results in bytes, 0 for no cap, and memory used by the results in memory
+// The growth of the table of the paths is charged to the cap too, the first 'paths_charged' bytes of the table already are
+static long memory_max = 0;
+static size_t memory_used = 0;
+static size_t paths_charged = 0;
+
+// Runs of results spilled when the memory cap is reached, in order of spill
+static Run_t *runs = NULL;
+static size_t n_runs = 0;
+
+// Buffer of size RUN_BUFFER for the records written to a run
+static char *run_buffer = NULL;
+
+// Shared memory ring written by the Worker threads, NULL if not available
+static ShmRing_t *ring = NULL;
+
+// Results arrived after the previous snapshot: the results in memory from index 'delta_index' and the runs from 'delta_run'
+static size_t delta_index = 0;
+static size_t delta_run = 0;
+
+// Child process printing a snapshot, -1 if none, and opcode of the snapshot requested while it runs, 0 if none
+static pid_t snapshot_pid = -1;
+static int snapshot_pending = 0;
+
+// Set when something has been printed, the prints are separated by an empty line
+static int printed = 0;
+
+// Output format of the results, set by the Master process
+static Output_t output_format = OUTPUT_TEXT;
+
+// Buffer of size OUTPUT_BUFFER of the output not written yet to the standard output
+static char *output = NULL;
+static size_t output_len = 0;
+
+// Offset in the string table of the filename of the next record of the binary output
+static uint64_t binary_offset = 0;
+
+// Quicksort compare function, equal results in order of index
+static int comparKeys(const void *a, const void *b) {
+    const SortKey_t *key_a = (const SortKey_t*)a;
+    const SortKey_t *key_b = (const SortKey_t*)b;
+
+    if (key_a->key != key_b->key)
+        return (key_a->key < key_b->key) ? -1 : 1;
+
+    return (key_a->index < key_b->index) ? -1 : (key_a->index > key_b->index);
+}
+
+// Grow the sort and merge buffers to 'n' elements, terminate the process on error
+static void growBuffers(size_t n) {
+    if (n <= merge_size) return;
+
+    uint32_t *new_buffer;
+    SortKey_t *new_keys, *new_tmp;
+
+    if ((new_buffer = realloc(merge_buffer, sizeof(uint32_t) * n)) != NULL) merge_buffer = new_buffer;
+    if ((new_keys = realloc(sort_keys, sizeof(SortKey_t) * n)) != NULL) sort_keys = new_keys;
+    if ((new_tmp = realloc(sort_tmp, sizeof(SortKey_t) * n)) != NULL) sort_tmp = new_tmp;
+
+    if ((new_buffer == NULL) || (new_keys == NULL) || (new_tmp == NULL)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m realloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    merge_size = n;
+}
+
+/*  Stable LSD radix sort of the 'n' keys in 'keys', RADIX_BITS bits per pass, using 'tmp' of the same size.
+ *  The passes on a digit equal for all the keys are skipped, the sorted keys are left in 'keys'.
+ */
+static void radixSortKeys(SortKey_t *keys, SortKey_t *tmp, size_t n) {
+    size_t count[RADIX_PASSES][RADIX_BUCKETS];
+    SortKey_t *src = keys, *dst = tmp, *swap;
+
+    // Histograms of all the digits in a single pass
+    memset(count, 0, sizeof(count));
+
+    for (size_t i = 0; i < n; i++) {
+        for (int pass = 0; pass < RADIX_PASSES; pass++)
+            count[pass][(keys[i].key >> (RADIX_BITS * pass)) & (RADIX_BUCKETS - 1)]++;
+    }
+
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        size_t *c = count[pass], offset = 0, tmp_count;
+        int shift = RADIX_BITS * pass;
+
+        // All the keys have the same digit, the pass would not move them
+        if (c[(src[0].key >> shift) & (RADIX_BUCKETS - 1)] == n) continue;
+
+        // Start of each bucket
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            tmp_count = c[b];
+            c[b] = offset;
+            offset += tmp_count;
+        }
+
+        for (size_t i = 0; i < n; i++)
+            dst[c[(src[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != keys) memcpy(keys, src, sizeof(SortKey_t) * n);
+}
+
+// Sort the 'n' keys in 'keys' using 'tmp' of the same size: with a radix sort from RADIX_MIN keys, with quicksort otherwise
+static void sortKeys(SortKey_t *keys, SortKey_t *tmp, size_t n) {
+    if (n >= RADIX_MIN)
+        radixSortKeys(keys, tmp, n);
+    else
+        qsort(keys, n, sizeof(SortKey_t), comparKeys);
+}
+
+/*  Number of keys of the sorted 'a' (of length 'na') among the first 'k' keys of its stable merge with the sorted 'b' (of length 'nb').
+ *  It is the smallest 'i' such that the key b[k - i - 1] comes before a[i], found with a binary search.
+ */
+static size_t corank(size_t k, const SortKey_t *a, size_t na, const SortKey_t *b, size_t nb) {
+    size_t low = (k > nb) ? k - nb : 0, high = (k < na) ? k : na, i;
+
+    while (low < high) {
+        i = low + (high - low) / 2;
+
+        if (b[k - i - 1].key < a[i].key)
+            high = i;
+        else
+            low = i + 1;
+    }
+
+    return low;
+}
+
+// Write the keys [first, last) of the stable merge of the sorted 'a' (of length 'na') and 'b' (of length 'nb') to 'dst'
+static void mergeKeys(const SortKey_t *a, size_t na, const SortKey_t *b, size_t nb, SortKey_t *dst, size_t first, size_t last) {
+    size_t i = corank(first, a, na, b, nb), j = first - i;
+
+    for (size_t k = first; k < last; k++) {
+        if ((j == nb) || ((i < na) && (a[i].key <= b[j].key)))
+            dst[k] = a[i++];
+        else
+            dst[k] = b[j++];
+    }
+}
+
+/*  Thread of a parallel sort, it sorts its chunk of keys, then at each round the threads of two sorted runs of chunks merge them,
+ *  each thread a part of the merged run. The sorted indexes of its chunk are written back in the run.
+ */
+static void *sort_thread(void *arg) {
+    SortThread_t *thread = (SortThread_t*) arg;
+    ParallelSort_t *sort = thread->sort;
+    size_t id = thread->id, n = sort->n, n_chunks = sort->n_threads;
+    size_t low = id * n / n_chunks, high = (id + 1) * n / n_chunks;
+    SortKey_t *src = sort_keys, *dst = sort_tmp, *swap;
+
+    for (size_t i = low; i < high; i++) {
+        sort_keys[i].key = ((uint64_t) keys[sort->run[i]]) ^ (UINT64_C(1) << 63);
+        sort_keys[i].index = sort->run[i];
+    }
+
+    sortKeys(sort_keys + low, sort_tmp + low, high - low);
+
+    for (size_t width = 1; width < n_chunks; width *= 2) {
+        // The runs of the previous round are complete
+        pthread_barrier_wait(&sort->barrier);
+
+        // Chunks [first, middle) and [middle, last) of the two runs merged by this thread
+        size_t first = id / (2 * width) * (2 * width);
+        size_t middle = (first + width < n_chunks) ? first + width : n_chunks;
+        size_t last = (first + 2 * width < n_chunks) ? first + 2 * width : n_chunks;
+        size_t a = first * n / n_chunks, b = middle * n / n_chunks, end = last * n / n_chunks;
+        size_t part = id - first, n_parts = last - first;
+
+        mergeKeys(src + a, b - a, src + b, end - b, dst + a, part * (end - a) / n_parts, (part + 1) * (end - a) / n_parts);
+
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (n_chunks > 1) pthread_barrier_wait(&sort->barrier);
+
+    for (size_t i = low; i < high; i++)
+        sort->run[i] = src[i].index;
+
+    return NULL;
+}
+
+/*  Run 'routine' on 'n' threads, the calling thread with args[0] and a new thread for each of args[1], ..., args[n - 1],
+ *  where the arguments are 'size' bytes each. Terminate the process on error.
+ */
+static void runThreads(void *(*routine)(void*), void *args, size_t size, size_t n) {
+    pthread_t *tids;
+    int error_number;
+
+    if ((tids = malloc(sizeof(pthread_t) * n)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        if ((error_number = pthread_create(&tids[i], NULL, routine, (char*) args + i * size)) != 0) {
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m pthread_create(): %s\n", strerror(error_number));
+            exit(error_number);
+        }
+    }
+
+    routine(args);
+
+    for (size_t i = 1; i < n; i++) {
+        if ((error_number = pthread_join(tids[i], NULL)) != 0) {
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m pthread_join(): %s\n", strerror(error_number));
+            exit(error_number);
+        }
+    }
+
+    free(tids);
+}
+
+/*  Sort in ascending order the 'n' results whose indexes are in 'run', terminate the process on error.
+ *  Equal results keep the order of their indexes, that is the order of arrival without a limit.
+ *  The results are sorted through a contiguous array of keys: with a radix sort from RADIX_MIN results, with quicksort otherwise.
+ *  From PARALLEL_MIN results the keys are sorted in chunks by the threads and merged in parallel, with chunks of at least RADIX_MIN keys.
+ */
+static void sortResults(uint32_t *run, size_t n) {
+    size_t n_chunks = (n >= PARALLEL_MIN) ? n / RADIX_MIN : 1;
+
+    if (n_chunks > (size_t) n_threads) n_chunks = n_threads;
+
+    growBuffers(n);
+
+    if (n_chunks == 1) {
+        for (size_t i = 0; i < n; i++) {
+            sort_keys[i].key = ((uint64_t) keys[run[i]]) ^ (UINT64_C(1) << 63);
+            sort_keys[i].index = run[i];
+        }
+
+        sortKeys(sort_keys, sort_tmp, n);
+
+        for (size_t i = 0; i < n; i++)
+            run[i] = sort_keys[i].index;
+
+        return;
+    }
+
+    ParallelSort_t sort;
+    SortThread_t *threads;
+    int error_number;
+
+    if ((threads = malloc(sizeof(SortThread_t) * n_chunks)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    if ((error_number = pthread_barrier_init(&sort.barrier, NULL, n_chunks)) != 0) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m pthread_barrier_init(): %s\n", strerror(error_number));
+        exit(error_number);
+    }
+
+    sort.run = run;
+    sort.n = n;
+    sort.n_threads = n_chunks;
+
+    for (size_t i = 0; i < n_chunks; i++) {
+        threads[i].sort = &sort;
+        threads[i].id = i;
+    }
+
+    runThreads(sort_thread, threads, sizeof(SortThread_t), n_chunks);
+
+    pthread_barrier_destroy(&sort.barrier);
+    free(threads);
+}
+
+/*  Merge the sorted run order[sorted, size) into the sorted run order[0, sorted), terminate the process on error.
+ *  The new run is copied in 'merge_buffer' and the two runs are merged from the end, so only the new results are moved twice.
+ *  Equal results keep the order of arrival, the new ones after the sorted ones.
+ */
+static void mergeResults(uint32_t *order, size_t sorted, size_t size) {
+    size_t n_new = size - sorted;
+
+    growBuffers(n_new);
+    memcpy(merge_buffer, order + sorted, sizeof(uint32_t) * n_new);
+
+    size_t i = sorted, j = n_new, k = size;
+
+    while (j > 0) {
+        if ((i > 0) && (keys[order[i - 1]] > keys[merge_buffer[j - 1]]))
+            order[--k] = order[--i];
+        else
+            order[--k] = merge_buffer[--j];
+    }
+}
+
+// Sort the results in ascending order, only the results arrived after the previous sort are sorted and merged with the others
+static void sortNewResults(uint32_t *order, size_t size, size_t *sorted) {
+    if (*sorted < size) {
+        // Sort the new results and merge them with the sorted ones
+        sortResults(order + *sorted, size - *sorted);
+
+        if (*sorted != 0) mergeResults(order, *sorted, size);
+
+        *sorted = size;
+    }
+}
+
+// Write the output in the buffer to the standard output, terminate the process on error
+static void flushOutput() {
+    if ((output_len != 0) && (writen(STDOUT_FILENO, output, output_len) == -1)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m writen() 'stdout': %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    output_len = 0;
+}
+
+// Append 'n' bytes of 'data' (at most OUTPUT_BUFFER) to the output, terminate the process on error
+static void outputBytes(const void *data, size_t n) {
+    if (output_len + n > OUTPUT_BUFFER) flushOutput();
+
+    memcpy(output + output_len, data, n);
+    output_len += n;
+}
+
+/*  Write the decimal representation of 'value' to 'buf', which has room for LONG_DIGITS_MAX characters.
+ *  The digits are produced two at a time from a table, from the last ones.
+ *
+ *  RETURN VALUE: number of characters written
+ */
+static size_t formatLong(char *buf, long value) {
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char digits[LONG_DIGITS_MAX], *p = digits + LONG_DIGITS_MAX;
+    unsigned long u = (value < 0) ? -(unsigned long) value : (unsigned long) value;
+
+    while (u >= 100) {
+        const char *pair = pairs + 2 * (u % 100);
+
+        u /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+
+    if (u >= 10) {
+        *--p = pairs[2 * u + 1];
+        *--p = pairs[2 * u];
+    } else {
+        *--p = '0' + u;
+    }
+
+    if (value < 0) *--p = '-';
+
+    size_t n = digits + LONG_DIGITS_MAX - p;
+
+    memcpy(buf, p, n);
+    return n;
+}
+
+/*  Write the line of 'result' and the filename of ID 'id' of length 'filename_len' to 'buf',
+ *  which has room for LONG_DIGITS_MAX + filename_len + 2 characters.
+ *
+ *  RETURN VALUE: number of characters written
+ */
+static size_t formatLine(char *buf, long result, uint64_t id, size_t filename_len) {
+    size_t n = formatLong(buf, result);
+
+    buf[n++] = ' ';
+    copyPath(paths, id, buf + n);
+    n += filename_len;
+    buf[n++] = '\n';
+
+    return n;
+}
+
+// Append the line of the result of index 'index' to the output, terminate the process on error
+static void outputResult(uint32_t index) {
+    size_t filename_len = lengthPath(paths, ids[index]);
+
+    if (output_len + LONG_DIGITS_MAX + filename_len + 2 > OUTPUT_BUFFER) flushOutput();
+
+    output_len += formatLine(output + output_len, keys[index], ids[index], filename_len);
+}
+
+// Append the line of 'result' and 'filename' of length 'filename_len' to the output, terminate the process on error
+static void outputLine(long result, const char filename[], size_t filename_len) {
+    if (output_len + LONG_DIGITS_MAX + filename_len + 2 > OUTPUT_BUFFER) flushOutput();
+
+    output_len += formatLong(output + output_len, result);
+    output[output_len++] = ' ';
+    memcpy(output + output_len, filename, filename_len);
+    output_len += filename_len;
+    output[output_len++] = '\n';
+}
+
+// Append the record of 'result' to the binary output, its 'filename' of length 'filename_len' follows the previous one in the string table
+static void outputRecord(long result, const char filename[], size_t filename_len) {
+    BinaryRecord_t record;
+
+    (void) filename;
+
+    record.result = result;
+    record.filename_offset = binary_offset;
+    binary_offset += filename_len + 1;
+
+    outputBytes(&record, sizeof(BinaryRecord_t));
+}
+
+// Append 'filename' of length 'filename_len' (and '\0') to the string table of the binary output, 'result' is not used
+static void outputString(long result, const char filename[], size_t filename_len) {
+    (void) result;
+
+    if (output_len + filename_len + 1 > OUTPUT_BUFFER) flushOutput();
+
+    memcpy(output + output_len, filename, filename_len);
+    output[output_len + filename_len] = '\0';
+    output_len += filename_len + 1;
+}
+
+// Print an empty line between two prints
+static void printSeparator() {
+    if (printed) outputBytes("\n", 1);
+    printed = 1;
+}
+
+// Append the line of the result of index 'index' to the buffer 'which' of 'thread', terminate the process on error
+static void formatResult(PrintThread_t *thread, int which, uint32_t index) {
+    size_t filename_len = lengthPath(paths, ids[index]);
+
+    // Double the buffer until the line fits
+    while (thread->size[which] - thread->len[which] < LONG_DIGITS_MAX + filename_len + 2) {
+        char *new_buf;
+
+        if ((new_buf = realloc(thread->buf[which], 2 * thread->size[which])) == NULL) {
+            int errsv = errno;
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m realloc(): %s\n", strerror(errsv));
+            exit(errsv);
+        }
+
+        thread->buf[which] = new_buf;
+        thread->size[which] *= 2;
+    }
+
+    thread->len[which] += formatLine(thread->buf[which] + thread->len[which], keys[index], ids[index], filename_len);
+}
+
+/*  Thread of a parallel print, at each round the threads format the lines of a block each, one after the other,
+ *  then the Collector thread (id 0) writes the lines of all the threads in order while the others format the next blocks.
+ *  Each thread alternates two buffers, the buffer of a round is written before the thread formats in it again.
+ */
+static void *print_thread(void *arg) {
+    PrintThread_t *thread = (PrintThread_t*) arg;
+    ParallelPrint_t *print = thread->print;
+    size_t round_size = print->n_threads * FORMAT_BLOCK;
+
+    for (size_t base = 0, round = 0; base < print->n; base += round_size, round++) {
+        int which = round % 2;
+        size_t first = base + thread->id * FORMAT_BLOCK, last = first + FORMAT_BLOCK;
+
+        if (last > print->n) last = print->n;
+
+        thread->len[which] = 0;
+
+        for (size_t i = first; i < last; i++)
+            formatResult(thread, which, print->run[i]);
+
+        // The lines of the round are formatted
+        pthread_barrier_wait(&print->barrier);
+
+        // The buffers of all the threads are written with a single system call, at most IOV_MAX at a time
+        if (thread->id == 0) {
+            for (size_t i = 0; i < print->n_threads; i++) {
+                print->iov[i].iov_base = print->threads[i].buf[which];
+                print->iov[i].iov_len = print->threads[i].len[which];
+            }
+
+            for (size_t i = 0; i < print->n_threads; i += IOV_MAX) {
+                int iovcnt = (print->n_threads - i < IOV_MAX) ? print->n_threads - i : IOV_MAX;
+
+                if (writevn(STDOUT_FILENO, print->iov + i, iovcnt) == -1) {
+                    int errsv = errno;
+                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m writevn() 'stdout': %s\n", strerror(errsv));
+                    exit(errsv);
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*  Print the lines of the 'size' results whose indexes are in 'run', in ascending order, terminate the process on error.
+ *  From PARALLEL_MIN results the lines are formatted by the threads in parallel.
+ */
+static void printResults(const uint32_t *run, size_t size) {
+    if ((n_threads == 1) || (size < PARALLEL_MIN)) {
+        // Print results
+        for (size_t i = 0; i < size; i++) {
+            outputResult(run[i]);
+        }
+
+        return;
+    }
+
+    // The lines of the threads follow the output already in the buffer
+    flushOutput();
+
+    ParallelPrint_t print;
+    int error_number;
+
+    if (((print.threads = calloc(n_threads, sizeof(PrintThread_t))) == NULL) || ((print.iov = malloc(sizeof(struct iovec) * n_threads)) == NULL)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    if ((error_number = pthread_barrier_init(&print.barrier, NULL, n_threads)) != 0) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m pthread_barrier_init(): %s\n", strerror(error_number));
+        exit(error_number);
+    }
+
+    print.run = run;
+    print.n = size;
+    print.n_threads = n_threads;
+
+    // The buffers hold the lines of a block of short filenames, they are doubled for longer ones
+    for (int i = 0; i < n_threads; i++) {
+        print.threads[i].print = &print;
+        print.threads[i].id = i;
+
+        for (int j = 0; j < 2; j++) {
+            if ((print.threads[i].buf[j] = malloc(FORMAT_BLOCK * 64)) == NULL) {
+                int errsv = errno;
+                fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+                exit(errsv);
+            }
+
+            print.threads[i].size[j] = FORMAT_BLOCK * 64;
+        }
+    }
+
+    runThreads(print_thread, print.threads, sizeof(PrintThread_t), n_threads);
+
+    for (int i = 0; i < n_threads; i++) {
+        free(print.threads[i].buf[0]);
+        free(print.threads[i].buf[1]);
+    }
+
+    pthread_barrier_destroy(&print.barrier);
+    free(print.threads);
+    free(print.iov);
+}
+
+/*  Write the sorted results in memory with index in [first, last) to a new run in the directory TMPDIR (default /tmp).
+ *  Terminate the process on error.
+ */
+static void writeRun(size_t first, size_t last) {
+    const char *tmpdir = getenv("TMPDIR");
+    char pathname[4096];
+    Run_t *new_runs;
+    int fd;
+
+    if ((tmpdir == NULL) || (tmpdir[0] == '\0')) tmpdir = "/tmp";
+
+    snprintf(pathname, sizeof(pathname), "%s/farm-run-XXXXXX", tmpdir);
+
+    // The file is unlinked at once, it is deleted when the Collector process terminates
+    if ((fd = mkstemp(pathname)) == -1) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m mkstemp() '%s': %s\n", pathname, strerror(errsv));
+        exit(errsv);
+    }
+
+    unlink(pathname);
+
+    if ((new_runs = realloc(runs, sizeof(Run_t) * (n_runs + 1))) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m realloc(): %s\n", strerror(errsv));
+        close(fd);
+        exit(errsv);
+    }
+
+    runs = new_runs;
+    runs[n_runs].fd = fd;
+    runs[n_runs].size = 0;
+    runs[n_runs].n_results = 0;
+    runs[n_runs].names_size = 0;
+    n_runs++;
+
+    // Write the records through a buffer, the whole buffer at a time
+    if ((run_buffer == NULL) && ((run_buffer = malloc(RUN_BUFFER)) == NULL)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    char *buf = run_buffer;
+    size_t len = 0, record_size;
+    int filename_len;
+
+    for (size_t i = 0; i < results_index; i++) {
+        if ((order[i] < first) || (order[i] >= last)) continue;
+
+        filename_len = lengthPath(paths, ids[order[i]]);
+        record_size = RUN_HEADER + filename_len;
+
+        if (len + record_size > RUN_BUFFER) {
+            if (writen(fd, buf, len) == -1) {
+                int errsv = errno;
+                fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m writen() 'run': %s\n", strerror(errsv));
+                exit(errsv);
+            }
+
+            runs[n_runs - 1].size += len;
+            len = 0;
+        }
+
+        memcpy(buf + len, &keys[order[i]], sizeof(long));
+        memcpy(buf + len + sizeof(long), &filename_len, sizeof(int));
+        copyPath(paths, ids[order[i]], buf + len + RUN_HEADER);
+        len += record_size;
+
+        runs[n_runs - 1].n_results++;
+        runs[n_runs - 1].names_size += filename_len + 1;
+    }
+
+    if ((len != 0) && (writen(fd, buf, len) == -1)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m writen() 'run': %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    runs[n_runs - 1].size += len;
+}
+
+// Slot of the file of ID 'id' in the hash table of the last results, a free slot if the file has no result
+static size_t find_slot(uint64_t id) {
+    // The IDs are offsets aligned to 8 bytes, multiplicative hashing spreads them
+    size_t mask = slots_size - 1, i = (size_t) (((id >> 3) * 11400714819323198485ULL) >> 32) & mask;
+
+    while ((slot_ids[i] != 0) && (slot_ids[i] != id)) i = (i + 1) & mask;
+
+    return i;
+}
+
+/*  Drop the replaced results, terminate the process on error.
+ *  The other results are moved down in order of arrival, so the sorted ones and the ones arrived after the previous snapshot stay so.
+ */
+static void compactResults() {
+    if (n_replaced == 0) return;
+
+    uint32_t *new_index;
+    size_t n = 0, n_sorted = 0, n_delta = 0, j = 0;
+
+    if ((new_index = malloc(sizeof(uint32_t) * results_index)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    for (size_t i = 0; i < results_index; i++) {
+        if (ids[i] == 0) {
+            new_index[i] = UINT32_MAX;
+            continue;
+        }
+
+        new_index[i] = n;
+        keys[n] = keys[i];
+        ids[n] = ids[i];
+        slot_indexes[find_slot(ids[n])] = n;
+
+        if (i < delta_index) n_delta++;
+
+        n++;
+    }
+
+    // Remove the replaced results from the permutation, the first 'results_sorted' are a permutation of the first indexes
+    for (size_t i = 0; i < results_index; i++) {
+        if (new_index[order[i]] != UINT32_MAX) {
+            if (i < results_sorted) n_sorted++;
+
+            order[j++] = new_index[order[i]];
+        }
+    }
+
+    free(new_index);
+
+    results_index = n;
+    results_sorted = n_sorted;
+    delta_index = n_delta;
+    n_replaced = 0;
+}
+
+/*  Sort the results in memory and write them to new runs, then delete them. Terminate the process on error.
+ *  The results arrived before and after the previous snapshot are written to two runs, so the delta prints read only the new runs.
+ */
+static void spillResults() {
+    sortNewResults(order, results_index, &results_sorted);
+
+    // The spill since the previous snapshot is the first one, the runs before it are not new
+    if (delta_index != 0) {
+        writeRun(0, delta_index);
+        delta_run = n_runs;
+    }
+
+    if (delta_index < results_index) writeRun(delta_index, results_index);
+
+    // Delete the results in memory, the arrays are kept
+    results_index = 0;
+    results_sorted = 0;
+    memory_used = 0;
+    delta_index = 0;
+
+    // The results spilled are never replaced
+    if (slot_ids != NULL) {
+        memset(slot_ids, 0, sizeof(uint64_t) * slots_size);
+        n_slots = 0;
+    }
+}
+
+/*  Read the next record of the run of 'reader', terminate the process on error.
+ *
+ *  RETURN VALUE: 1 if a record was read
+ *                0 at the end of the run
+ */
+static int nextRecord(RunReader_t *reader) {
+    size_t available = reader->len - reader->pos;
+    int filename_len = -1;
+
+    if (available >= RUN_HEADER) memcpy(&filename_len, reader->buf + reader->pos + sizeof(long), sizeof(int));
+
+    // Refill the buffer when it does not hold a whole record
+    if ((available < RUN_HEADER) || (filename_len < 0) || (available < RUN_HEADER + filename_len)) {
+        memmove(reader->buf, reader->buf + reader->pos, reader->len - reader->pos);
+        reader->len -= reader->pos;
+        reader->pos = 0;
+
+        ssize_t n_read;
+
+        while ((reader->len < RUN_BUFFER) && (reader->offset < reader->size)) {
+            if ((n_read = pread(reader->fd, reader->buf + reader->len, RUN_BUFFER - reader->len, reader->offset)) == -1) {
+                if (errno == EINTR) continue;
+
+                int errsv = errno;
+                fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m pread() 'run': %s\n", strerror(errsv));
+                exit(errsv);
+            } else if (n_read == 0) {
+                break;
+            }
+
+            reader->len += n_read;
+            reader->offset += n_read;
+        }
+
+        if (reader->len == 0) return 0;
+
+        if (reader->len >= RUN_HEADER) memcpy(&filename_len, reader->buf + sizeof(long), sizeof(int));
+
+        if ((reader->len < RUN_HEADER) || (filename_len < 0) || (reader->len < RUN_HEADER + filename_len)) {
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'run': Invalid record\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    memcpy(&reader->result, reader->buf + reader->pos, sizeof(long));
+    reader->filename = reader->buf + reader->pos + RUN_HEADER;
+    reader->filename_len = filename_len;
+    reader->pos += RUN_HEADER + filename_len;
+
+    return 1;
+}
+
+// Check if the source 'a' of the merge comes before the source 'b', equal results in order of spill
+static int before(const MergeSource_t *a, const MergeSource_t *b) {
+    return (a->result < b->result) || ((a->result == b->result) && (a->source < b->source));
+}
+
+// Restore the heap of the 'n' sources of the merge from 'i' down
+static void siftMerge(MergeSource_t *heap, size_t n, size_t i) {
+    MergeSource_t item = heap[i];
+    size_t child;
+
+    while ((child = 2 * i + 1) < n) {
+        if ((child + 1 < n) && before(&heap[child + 1], &heap[child])) child++;
+        if (!before(&heap[child], &item)) break;
+
+        heap[i] = heap[child];
+        i = child;
+    }
+
+    heap[i] = item;
+}
 
-// Cleanup array of results
-static void deleteResults(Result_t **results, size_t size) {
-    if (size != 0) {
-        for (size_t i = 0; i < size; i++) {
-            free(results[i]->filename);
-            free(results[i]);
+/*  Pass to 'emit' in ascending order the results of the spilled runs from 'first_run' merged with the 'n_memory'
+ *  sorted results whose indexes are in 'memory'. Terminate the process on error.
+ */
+static void printMerged(size_t first_run, const uint32_t *memory, size_t n_memory, void (*emit)(long, const char[], size_t)) {
+    RunReader_t *readers;
+    MergeSource_t *heap;
+    size_t n_readers = n_runs - first_run, n_heap = 0, memory_index = 0, filename_len, filename_size = 0;
+    char *filename = NULL;
+
+    if (((readers = malloc(sizeof(RunReader_t) * n_readers)) == NULL) || ((heap = malloc(sizeof(MergeSource_t) * (n_readers + 1))) == NULL)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    // Start a reader for each run, the runs are read again at each print
+    for (size_t i = 0; i < n_readers; i++) {
+        readers[i].fd = runs[first_run + i].fd;
+        readers[i].offset = 0;
+        readers[i].size = runs[first_run + i].size;
+        readers[i].len = 0;
+        readers[i].pos = 0;
+
+        if ((readers[i].buf = malloc(RUN_BUFFER)) == NULL) {
+            int errsv = errno;
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+            exit(errsv);
+        }
+
+        if (nextRecord(&readers[i])) {
+            heap[n_heap].result = readers[i].result;
+            heap[n_heap].source = i;
+            n_heap++;
         }
     }
 
-    free(results);
+    // The results in memory are the last source, they arrived after the spilled ones
+    if (n_memory != 0) {
+        heap[n_heap].result = keys[memory[0]];
+        heap[n_heap].source = n_readers;
+        n_heap++;
+    }
+
+    for (size_t i = n_heap / 2; i-- > 0;)
+        siftMerge(heap, n_heap, i);
+
+    // Print the smallest current result and advance its source
+    while (n_heap != 0) {
+        size_t source = heap[0].source;
+
+        if (source == n_readers) {
+            // The filename of a result in memory is copied from the table of the paths
+            if ((filename_len = lengthPath(paths, ids[memory[memory_index]])) > filename_size) {
+                char *new_filename;
+
+                if ((new_filename = realloc(filename, filename_len)) == NULL) {
+                    int errsv = errno;
+                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m realloc(): %s\n", strerror(errsv));
+                    exit(errsv);
+                }
+
+                filename = new_filename;
+                filename_size = filename_len;
+            }
+
+            copyPath(paths, ids[memory[memory_index]], filename);
+            emit(keys[memory[memory_index]], filename, filename_len);
+
+            if (++memory_index < n_memory)
+                heap[0].result = keys[memory[memory_index]];
+            else
+                heap[0] = heap[--n_heap];
+        } else {
+            emit(readers[source].result, readers[source].filename, readers[source].filename_len);
+
+            if (nextRecord(&readers[source]))
+                heap[0].result = readers[source].result;
+            else
+                heap[0] = heap[--n_heap];
+        }
+
+        if (n_heap != 0) siftMerge(heap, n_heap, 0);
+    }
+
+    for (size_t i = 0; i < n_readers; i++)
+        free(readers[i].buf);
+
+    free(readers);
+    free(heap);
+    free(filename);
 }
 
-// Quicksort compare function
-static int comparResults(const void *a, const void *b) {
-    Result_t *res_a = *(Result_t**)a;
-    Result_t *res_b = *(Result_t**)b;
+/*  Print a block of the binary output with the results of the spilled runs from 'first_run' and the 'n_memory' sorted results
+ *  whose indexes are in 'memory': the header, the records and the string table, each of them after a merge of the sources.
+ *  Terminate the process on error.
+ */
+static void printBinary(size_t first_run, const uint32_t *memory, size_t n_memory) {
+    BinaryHeader_t header;
 
-    if (res_a->result < res_b->result) {
-        return -1;
-    } else if (res_a->result > res_b->result) {
-        return 1;
+    memset(&header, 0, sizeof(BinaryHeader_t));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.record_size = sizeof(BinaryRecord_t);
+    header.n_records = n_memory;
+
+    for (size_t i = 0; i < n_memory; i++)
+        header.strings_size += lengthPath(paths, ids[memory[i]]) + 1;
+
+    for (size_t i = first_run; i < n_runs; i++) {
+        header.n_records += runs[i].n_results;
+        header.strings_size += runs[i].names_size;
+    }
+
+    outputBytes(&header, sizeof(BinaryHeader_t));
+
+    binary_offset = 0;
+    printMerged(first_run, memory, n_memory, outputRecord);
+    printMerged(first_run, memory, n_memory, outputString);
+}
+
+/*  Print the results kept in ascending order, with 'delta' only the results arrived after the previous snapshot.
+ *  With a limit the heap is copied and sorted, the delta is the whole heap. Terminate the process on error.
+ */
+static void printSnapshot(int delta) {
+    const uint32_t *memory = order;
+    size_t n_memory = results_index, first_run = 0;
+
+    if ((top_k == 0) && !delta) {
+        // Only the results arrived after the previous sort are sorted and merged with the others
+        sortNewResults(order, results_index, &results_sorted);
+    } else {
+        if (top_k == 0) {
+            n_memory = results_index - delta_index;
+            first_run = delta_run;
+        }
+
+        if (n_memory > top_size) {
+            uint32_t *new_buffer;
+
+            if ((new_buffer = realloc(top_buffer, sizeof(uint32_t) * n_memory)) == NULL) {
+                int errsv = errno;
+                fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m realloc(): %s\n", strerror(errsv));
+                exit(errsv);
+            }
+
+            top_buffer = new_buffer;
+            top_size = n_memory;
+        }
+
+        // Copy the heap or the indexes of the new results, in order of arrival
+        if (top_k != 0) {
+            memcpy(top_buffer, order, sizeof(uint32_t) * n_memory);
+        } else {
+            for (size_t i = 0; i < n_memory; i++)
+                top_buffer[i] = delta_index + i;
+        }
+
+        sortResults(top_buffer, n_memory);
+        memory = top_buffer;
+    }
+
+    // Nothing to print
+    if ((n_memory == 0) && (first_run == n_runs)) return;
+
+    if (output_format == OUTPUT_BINARY) {
+        printBinary(first_run, memory, n_memory);
     } else {
+        printSeparator();
+
+        if (first_run == n_runs)
+            printResults(memory, n_memory);
+        else
+            printMerged(first_run, memory, n_memory, outputLine);
+    }
+
+    flushOutput();
+}
+
+/*  Wait for the child process printing a snapshot, without blocking if 'nohang' is set.
+ *  Terminate the process on error, also if the child process fails.
+ *
+ *  RETURN VALUE: 1 if no snapshot is being printed
+ *                0 if the snapshot is still being printed
+ */
+static int waitSnapshot(int nohang) {
+    if (snapshot_pid == -1) return 1;
+
+    pid_t wait_return;
+    int status;
+
+    while (((wait_return = waitpid(snapshot_pid, &status, nohang ? WNOHANG : 0)) == -1) && (errno == EINTR));
+
+    if (wait_return == -1) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m waitpid() 'snapshot': %s\n", strerror(errsv));
+        exit(errsv);
+    } else if (wait_return == 0) {
         return 0;
     }
+
+    snapshot_pid = -1;
+
+    // The child process has already reported its error
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))
+        exit(WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE);
+
+    return 1;
+}
+
+/*  Print a snapshot of the results, with 'delta' only the results arrived after the previous snapshot, terminate the process on error.
+ *  The snapshot is sorted and printed by a child process, a copy-on-write view of the results, while the results keep being read.
+ *  Without the child process the snapshot is printed at once.
+ */
+static void startSnapshot(int delta) {
+    int empty;
+
+    // The replaced results are not printed
+    compactResults();
+
+    if ((top_k == 0) && delta)
+        empty = (results_index == delta_index) && (n_runs == delta_run);
+    else
+        empty = (results_index == 0) && (n_runs == 0);
+
+    // The output still buffered would be printed by both the processes
+    flushOutput();
+
+    if ((snapshot_pid = fork()) == -1) {
+        printSnapshot(delta);
+    } else if (snapshot_pid == 0) {
+        // The ring and the connections are left to the Collector process
+        ring = NULL;
+
+        printSnapshot(delta);
+        _exit(EXIT_SUCCESS);
+    } else if (!empty) {
+        // The next print is separated from the snapshot
+        printed = 1;
+    }
+
+    delta_index = results_index;
+    delta_run = n_runs;
+}
+
+// Function registered using atexit()
+static void cleanup() {
+    free(keys);
+    free(ids);
+    free(order);
+    free(top_buffer);
+    free(merge_buffer);
+    free(sort_keys);
+    free(sort_tmp);
+    free(output);
+    for (size_t i = 0; i < n_runs; i++) close(runs[i].fd);
+    free(runs);
+    free(run_buffer);
+    if (epfd != -1) close(epfd);
+    deleteShmRing(ring);
+    deletePathTable(paths);
+    close(sfd);
+}
+
+// Read 'n' bytes of 'name' from file descriptor 'fd' into 'buf', terminate the process on error or end of file
+static void read_exit(int fd, void *buf, size_t n, const char name[]) {
+    int read_return;
+
+    if ((read_return = readn(fd, buf, n)) == -1) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() '%s': %s\n", name, strerror(errsv));
+        exit(errsv);
+    } else if (read_return == 0) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() '%s': End of file\n", name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Check if the result 'a' leaves the top k before the result 'b'
+static int drop_first(long a, long b) {
+    return (top_k > 0) ? (a > b) : (a < b);
+}
+
+// Restore the heap of results from the root down
+static void sift_down() {
+    size_t i = 0, child;
+    uint32_t root = order[0];
+
+    while ((child = 2 * i + 1) < results_index) {
+        if ((child + 1 < results_index) && drop_first(keys[order[child + 1]], keys[order[child]]))
+            child++;
+
+        if (!drop_first(keys[order[child]], keys[root]))
+            break;
+
+        order[i] = order[child];
+        i = child;
+    }
+
+    order[i] = root;
+}
+
+// Restore the heap of results from the last one up
+static void sift_up() {
+    size_t i = results_index - 1, parent;
+    uint32_t last = order[i];
+
+    while ((i > 0) && drop_first(keys[last], keys[order[parent = (i - 1) / 2]])) {
+        order[i] = order[parent];
+        i = parent;
+    }
+
+    order[i] = last;
+}
+
+// Double the arrays of results, with a limit they never exceed k results, terminate the process on error
+static void grow_results(size_t limit) {
+    size_t new_size = (results_size == 0) ? RESULTS_SIZE : 2 * results_size;
+    long *new_keys;
+    uint64_t *new_ids;
+    uint32_t *new_order;
+
+    if ((top_k != 0) && (new_size > limit)) new_size = limit;
+
+    // The indexes of the results are 32-bit
+    if (new_size > UINT32_MAX) new_size = UINT32_MAX;
+
+    if ((new_keys = realloc(keys, sizeof(long) * new_size)) != NULL) keys = new_keys;
+    if ((new_ids = realloc(ids, sizeof(uint64_t) * new_size)) != NULL) ids = new_ids;
+    if ((new_order = realloc(order, sizeof(uint32_t) * new_size)) != NULL) order = new_order;
+
+    if ((new_keys == NULL) || (new_ids == NULL) || (new_order == NULL)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m realloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    results_size = new_size;
 }
 
-// Print results sorted with quicksort algorithm
-static void printResults(Result_t **results, size_t size, int *ordered) {
-    if (size != 0) {
-        if (!*ordered) {
-            // Sort array in ascending order
-            qsort(results, size, sizeof(Result_t*), comparResults);
-            *ordered = 1;
+// Double the hash table of the last results, terminate the process on error
+static void grow_slots() {
+    uint64_t *old_ids = slot_ids, *old_submissions = slot_submissions;
+    uint32_t *old_indexes = slot_indexes;
+    size_t old_size = slots_size;
+
+    slots_size = (old_size == 0) ? REPLACE_SLOTS : 2 * old_size;
+
+    if (((slot_ids = calloc(slots_size, sizeof(uint64_t))) == NULL) || ((slot_submissions = malloc(sizeof(uint64_t) * slots_size)) == NULL) ||
+        ((slot_indexes = malloc(sizeof(uint32_t) * slots_size)) == NULL)) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    for (size_t i = 0; i < old_size; i++) {
+        if (old_ids[i] != 0) {
+            size_t slot = find_slot(old_ids[i]);
+
+            slot_ids[slot] = old_ids[i];
+            slot_submissions[slot] = old_submissions[i];
+            slot_indexes[slot] = old_indexes[i];
         }
+    }
+
+    free(old_ids);
+    free(old_submissions);
+    free(old_indexes);
+}
 
-        static int first = 1;
-        if (!first) printf("\n");
-        first = 0;
+/*  Keep the result of index 'index' of ID 'id' and submission number 'submission' if it is the last result of its file,
+ *  the other one is replaced. The Master process numbers the calculations in order of submission and a file keeps its ID:
+ *  the results of the Worker threads arrive in any order, an older result does not replace a newer one.
+ */
+static void replace_result(uint64_t id, uint64_t submission, uint32_t index) {
+    if (2 * (n_slots + 1) > slots_size) grow_slots();
 
-        // Print results
-        for (size_t i = 0; i < size; i++) {
-            printf("%ld %s\n", results[i]->result, results[i]->filename);
+    size_t slot = find_slot(id);
+
+    if (slot_ids[slot] == 0) {
+        n_slots++;
+    } else if (slot_submissions[slot] > submission) {
+        ids[index] = 0;
+        n_replaced++;
+        return;
+    } else {
+        ids[slot_indexes[slot]] = 0;
+        n_replaced++;
+    }
+
+    slot_ids[slot] = id;
+    slot_submissions[slot] = submission;
+    slot_indexes[slot] = index;
+
+    // The replaced results are dropped before they are the majority, a file that keeps changing does not fill the memory
+    if ((n_replaced >= RESULTS_SIZE) && (2 * n_replaced > results_index)) compactResults();
+}
+
+// Add the 'result' of the submission number 'submission' of the file of ID 'id', terminate the process on error
+static void add_result(uint64_t id, uint64_t submission, long result) {
+    size_t limit = (top_k > 0) ? (size_t) top_k : (size_t) -(long) top_k;
+    uint32_t index;
+    int replaced = 0;
+
+    // The ID must refer to a path published by the Master process
+    if (!checkPath(paths, id)) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'id': Invalid value\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // With a full heap, a result that would leave the top k at once is dropped
+    if ((top_k != 0) && (results_index == limit)) {
+        if (!drop_first(keys[order[0]], result))
+            return;
+
+        // Replace the root
+        index = order[0];
+        replaced = 1;
+    } else {
+        // Without a limit the results beyond the 32-bit indexes are spilled, once the replaced ones are dropped
+        if ((top_k == 0) && (results_index == UINT32_MAX)) {
+            compactResults();
+
+            if (results_index == UINT32_MAX) spillResults();
         }
+
+        // Grow the arrays of results if they are full, the number of results is not known in advance
+        if (results_index == results_size) grow_results(limit);
+
+        index = results_index;
+        order[results_index++] = index;
+    }
+
+    keys[index] = result;
+    ids[index] = id;
+
+    if (replace) replace_result(id, submission, index);
+
+    if (top_k != 0) {
+        // The root was replaced or a result was added at the end of the heap
+        if (replaced)
+            sift_down();
+        else
+            sift_up();
+
+        return;
+    }
+
+    // Spill the results to a run when the memory cap is reached, the paths added to the table since the previous result count too
+    if (memory_max != 0) {
+        size_t used = usedPathTable(paths);
+
+        memory_used += RESULT_MEMORY + (used - paths_charged);
+        paths_charged = used;
+
+        if (memory_used >= (size_t) memory_max) spillResults();
     }
 }
 
-// Code exec by Collector process
-void exec_collector() {
-    // Create a new UNIX socket
-    int sfd;
+// Read from 'fd' the results of message 'opcode' (a batch), terminate the process on error
+static void read_results(int fd, int opcode) {
+    if (opcode == OPCODE_BATCH) {
+        // Read number of results and length of the payload
+        int batch_header[2];
+
+        read_exit(fd, batch_header, sizeof(batch_header), "batch_header");
+
+        // Check the read values, the payload holds exactly the results
+        if ((batch_header[0] <= 0) || (batch_header[1] > BATCH_MAX) || ((size_t) batch_header[1] != batch_header[0] * sizeof(FileResult_t))) {
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'batch_header': Invalid value\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // Read the payload with a single read
+        static FileResult_t payload[BATCH_MAX / sizeof(FileResult_t)];
+
+        read_exit(fd, payload, batch_header[1], "payload");
+
+        for (int i = 0; i < batch_header[0]; i++)
+            add_result(payload[i].id, payload[i].submission, payload[i].result);
+    } else {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'opcode': Invalid value\n");
+        exit(EXIT_FAILURE);
+    }
+}
 
+/*  Add all the results published in the ring.
+ *
+ *  RETURN VALUE: number of results added
+ */
+static size_t drain_ring() {
+    uint64_t id, submission;
+    long result;
+    size_t n = 0;
+
+    while (popShmRing(ring, &id, &submission, &result)) {
+        add_result(id, submission, result);
+        n++;
+    }
+
+    return n;
+}
+
+/*  Request a snapshot for the print opcode 'opcode' (OPCODE_PRINT or OPCODE_DELTA), terminate the process on error.
+ *  While another snapshot is being printed the request waits for it, the requests waiting are merged into one.
+ */
+static void requestSnapshot(int opcode) {
+    if ((snapshot_pending == 0) || (opcode == OPCODE_PRINT)) snapshot_pending = opcode;
+
+    if (waitSnapshot(1)) {
+        if (ring != NULL) drain_ring();
+
+        startSnapshot(snapshot_pending == OPCODE_DELTA);
+        snapshot_pending = 0;
+    }
+}
+
+/*  Send the 'result' of the submission number 'submission' of the file of ID 'id' to the Collector process: in the shared
+ *  memory ring 'ring' if not NULL, otherwise in 'batch', sent on the channel 'fd' when it is full.
+ *  Safe to call from many threads, each with its own batch.
+ *
+ *  RETURN VALUE: 1 if the result is in the batch
+ *                0 if the result is in the ring
+ *                -1 on error (errno is set)
+ */
+int sendResult(ShmRing_t *ring, ResultBatch_t *batch, int fd, uint64_t id, uint64_t submission, long result) {
+    // With the shared memory ring the result is published immediately, there is no syscall to amortize
+    if (ring != NULL) return pushShmRing(ring, id, submission, result);
+
+    if (((size_t) batch->count == BATCH_MAX / sizeof(FileResult_t)) && (flushResults(batch, fd) == -1))
+        return -1;
+
+    batch->payload[batch->count].id = id;
+    batch->payload[batch->count].submission = submission;
+    batch->payload[batch->count].result = result;
+    batch->count++;
+
+    return 1;
+}
+
+/*  Send the results in 'batch' on the channel 'fd' as one message with a single writev(), nothing if it is empty.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int flushResults(ResultBatch_t *batch, int fd) {
+    if (batch->count == 0) return 0;
+
+    int header[3] = { OPCODE_BATCH, batch->count, batch->count * sizeof(FileResult_t) };
+    struct iovec iov[2] = { { header, sizeof(header) }, { batch->payload, header[2] } };
+
+    if (writevn(fd, iov, 2) == -1) return -1;
+
+    batch->count = 0;
+
+    return 0;
+}
+
+// Code exec by Collector process, 'shm_ring' is the ring created by the Master process before fork() or NULL, 'path_table' the table of the paths
+void exec_collector(ShmRing_t *shm_ring, PathTable_t *path_table) {
+    ring = shm_ring;
+    paths = path_table;
+
+    // Create a new UNIX socket
     if ((sfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
         int errsv = errno;
-        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m socket(): %s\n", strerror(errsv)); 
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m socket(): %s\n", strerror(errsv));
         exit(errsv);
     }
 
@@ -80,141 +1556,220 @@ void exec_collector() {
     // Connect to the Master process
     if (connect(sfd, (struct sockaddr*) &addr, sizeof(addr)) == -1) {
         int errsv = errno;
-        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m connect(): %s\n", strerror(errsv)); 
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m connect(): %s\n", strerror(errsv));
+        close(sfd);
         exit(errsv);
     }
 
-    int n_results, read_return;
+    // Register the cleanup function
+    if (atexit(cleanup) != 0) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m atexit()\n");
+        close(sfd);
+        exit(EXIT_FAILURE);
+    }
+
+    int read_return;
 
-    // Read the total number of results
+    // Read the number of results to keep
     // If read EOF terminate the process, error in the Master process (Commonly caused by CLI parsing)
-    if ((read_return = readn(sfd, &n_results, sizeof(int))) == -1) {
+    if ((read_return = readn(sfd, &top_k, sizeof(int))) == -1) {
         int errsv = errno;
-        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'n_results': %s\n", strerror(errsv)); 
-        close(sfd);
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'top_k': %s\n", strerror(errsv));
         exit(errsv);
     } else if (read_return == 0) {
-        close(sfd);
-        exit(EXIT_FAILURE);      
+        exit(EXIT_FAILURE);
     }
-    
-    // Check the read value
-    if (n_results <= 0){
-        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'n_results': Invalid value\n"); 
-        close(sfd);
+
+    // Read the memory cap of the results
+    read_exit(sfd, &memory_max, sizeof(long), "memory_max");
+
+    if (memory_max < 0) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'memory_max': Invalid value\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Read the number of threads sorting and printing the results
+    read_exit(sfd, &n_threads, sizeof(int), "n_threads");
+
+    if (n_threads < 1) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'n_threads': Invalid value\n");
         exit(EXIT_FAILURE);
     }
 
-    // Allocate results array of size 'n_results'
-    Result_t **results;
-    size_t results_index = 0;
+    // Read the output format
+    int format;
+
+    read_exit(sfd, &format, sizeof(int), "output_format");
+
+    if ((format != OUTPUT_TEXT) && (format != OUTPUT_BINARY)) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'output_format': Invalid value\n");
+        exit(EXIT_FAILURE);
+    }
+
+    output_format = format;
+
+    // Read if a new result of a file replaces its previous one, the results are never dropped or spilled
+    read_exit(sfd, &replace, sizeof(int), "replace");
+
+    if ((replace != 0) && ((top_k != 0) || (memory_max != 0))) {
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'replace': Invalid value\n");
+        exit(EXIT_FAILURE);
+    }
 
-    if ((results = malloc(sizeof(Result_t*) * n_results)) == NULL) {
+    // Allocate buffer for the output
+    if ((output = malloc(OUTPUT_BUFFER)) == NULL) {
         int errsv = errno;
         fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
-        close(sfd);
         exit(errsv);
     }
 
-    int opcode, ordered = 0;
+    // Create the epoll instance and register the Master connection
+    struct epoll_event event, events[MAX_EVENTS];
+
+    if ((epfd = epoll_create1(0)) == -1) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m epoll_create1(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = sfd;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &event) == -1) {
+        int errsv = errno;
+        fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m epoll_ctl(): %s\n", strerror(errsv));
+        exit(errsv);
+    }
+
+    // Register the eventfd of the ring, written by the Worker threads when the Collector is waiting
+    if (ring != NULL) {
+        event.events = EPOLLIN;
+        event.data.fd = ring->efd;
 
-    // Loop
-    while (1) {
-        // Read opcode
-        if ((read_return = readn(sfd, &opcode, sizeof(int))) == -1) {
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, ring->efd, &event) == -1) {
             int errsv = errno;
-            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'opcode': %s\n", strerror(errsv));
-            deleteResults(results, results_index);
-            close(sfd);
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m epoll_ctl(): %s\n", strerror(errsv));
             exit(errsv);
-        } else if (read_return == 0) {
-            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'opcode': End of file\n");
-            deleteResults(results, results_index);
-            close(sfd);
-            exit(EXIT_FAILURE);
         }
+    }
 
-        switch (opcode) {
-            // Successful termination of the process
-            case 0:
-                printResults(results, results_index, &ordered);
-                deleteResults(results, results_index);
-                close(sfd);
-                exit(EXIT_SUCCESS);
-            // Print partial results
-            case -1:
-                printResults(results, results_index, &ordered);
-                break;
-            // Read new result of filename
-            default:
-                // Check the read value
-                if (opcode < 0) {
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'opcode': Invalid value\n\n");
-                    deleteResults(results, results_index);
-                    close(sfd);
-                    exit(EXIT_FAILURE);
-                }
+    // Number of open Worker channels, set when the exit opcode is received
+    int n_channels = 0, exiting = 0, n_events, opcode, channel_fd, timeout;
 
-                // Allocate result structure
-                Result_t *new_result;
+    // Loop until the exit opcode is received and all the Worker channels are closed
+    while (!exiting || (n_channels != 0)) {
+        // Drain the ring, then wait only if it is still empty
+        // While results keep coming wait at most RING_LATENCY, so the Worker threads wake up the Collector only on a half full ring
+        timeout = -1;
 
-                if ((new_result = malloc(sizeof(Result_t))) == NULL) {
-                    int errsv = errno;
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
-                    deleteResults(results, results_index);
-                    close(sfd);
-                    exit(errsv);
-                }
+        if (ring != NULL) {
+            if (drain_ring() != 0) timeout = RING_LATENCY;
+            if (!sleepShmRing(ring, timeout != -1)) timeout = 0;
+        }
 
-                // Allocate memory for filename of size 'opcode' 
-                if ((new_result->filename = malloc(opcode * sizeof(char))) == NULL) {
-                    int errsv = errno;
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m malloc(): %s\n", strerror(errsv));
-                    deleteResults(results, results_index);
-                    close(sfd);
-                    exit(errsv);
-                }
+        // Check the end of the snapshot being printed while another one waits for it
+        if (snapshot_pending != 0) {
+            requestSnapshot(snapshot_pending);
+
+            if ((snapshot_pending != 0) && ((timeout == -1) || (timeout > SNAPSHOT_POLL))) timeout = SNAPSHOT_POLL;
+        }
+
+        n_events = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+
+        if (ring != NULL) awakeShmRing(ring);
+
+        if (n_events == -1) {
+            if (errno == EINTR) continue;
+
+            int errsv = errno;
+            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m epoll_wait(): %s\n", strerror(errsv));
+            exit(errsv);
+        }
 
-                // Read filename
-                if ((read_return = readn(sfd, new_result->filename, opcode * sizeof(char))) == -1) {
+        for (int i = 0; i < n_events; i++) {
+            if ((ring != NULL) && (events[i].data.fd == ring->efd)) {
+                // New results in the ring, drained at the next iteration
+                continue;
+            } else if (events[i].data.fd == sfd) {
+                // Read opcode from the Master process, it may carry a Worker channel
+                if ((read_return = recvfd(sfd, &opcode, sizeof(int), &channel_fd)) == -1) {
                     int errsv = errno;
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'filename': %s\n", strerror(errsv));
-                    deleteResults(results, results_index);
-                    close(sfd);
+                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m recvfd() 'opcode': %s\n", strerror(errsv));
                     exit(errsv);
                 } else if (read_return == 0) {
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'filename': End of file\n");
-                    deleteResults(results, results_index);
-                    close(sfd);
+                    // Without any result, error in the Master process before the stream started (Commonly caused by CLI parsing)
+                    if (results_index == 0) exit(EXIT_FAILURE);
+
+                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m recvfd() 'opcode': End of file\n");
                     exit(EXIT_FAILURE);
                 }
 
-                // Read result
-                if ((read_return = readn(sfd, &new_result->result, sizeof(long))) == -1) {
+                // Only the channel opcode may carry a file descriptor
+                if ((opcode != OPCODE_CHANNEL) && (channel_fd != -1)) close(channel_fd);
+
+                switch (opcode) {
+                    // End of the stream of results, successful termination of the process once the Worker channels are drained
+                    case OPCODE_EXIT:
+                        exiting = 1;
+                        epoll_ctl(epfd, EPOLL_CTL_DEL, sfd, NULL);
+                        break;
+                    // Print partial results, all of them or only the ones arrived after the previous print
+                    case OPCODE_PRINT:
+                    case OPCODE_DELTA:
+                        requestSnapshot(opcode);
+                        break;
+                    // Register a new Worker channel
+                    case OPCODE_CHANNEL:
+                        if (channel_fd == -1) {
+                            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m 'channel': Missing file descriptor\n");
+                            exit(EXIT_FAILURE);
+                        }
+
+                        event.events = EPOLLIN;
+                        event.data.fd = channel_fd;
+
+                        if (epoll_ctl(epfd, EPOLL_CTL_ADD, channel_fd, &event) == -1) {
+                            int errsv = errno;
+                            fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m epoll_ctl(): %s\n", strerror(errsv));
+                            exit(errsv);
+                        }
+
+                        n_channels++;
+                        break;
+                    // Read new results
+                    default:
+                        read_results(sfd, opcode);
+                }
+            } else {
+                // Read opcode from a Worker channel, end of file when the Worker thread terminates
+                if ((read_return = readn(events[i].data.fd, &opcode, sizeof(int))) == -1) {
                     int errsv = errno;
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'result': %s\n", strerror(errsv));
-                    deleteResults(results, results_index);
-                    close(sfd);
+                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'opcode': %s\n", strerror(errsv));
                     exit(errsv);
                 } else if (read_return == 0) {
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m readn() 'result': End of file\n");
-                    deleteResults(results, results_index);
-                    close(sfd);
-                    exit(EXIT_FAILURE);
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, events[i].data.fd, NULL);
+                    close(events[i].data.fd);
+                    n_channels--;
+                } else {
+                    read_results(events[i].data.fd, opcode);
                 }
+            }
+        }
+    }
 
-                // Check if Master process send more results than 'n_results'
-                if (results_index >= ((size_t) n_results)) {
-                    fprintf(stderr, "collector: \x1B[1;31merror:\x1B[0m Too many results\n");
-                    deleteResults(results, results_index);
-                    close(sfd);
-                    exit(EXIT_FAILURE);
-                }
+    // The Worker threads have terminated, collect the last results of the ring
+    if (ring != NULL) drain_ring();
 
-                // Add new result
-                results[results_index] = new_result;
-                results_index++;
-                ordered = 0;
-        }
+    // Print the snapshot still waiting, then the results once the snapshots are printed
+    waitSnapshot(0);
+
+    if (snapshot_pending != 0) {
+        startSnapshot(snapshot_pending == OPCODE_DELTA);
+        waitSnapshot(0);
     }
-}
\ No newline at end of file
+
+    compactResults();
+    printSnapshot(0);
+    exit(EXIT_SUCCESS);
+}
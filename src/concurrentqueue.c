@@ -1,11 +1,52 @@
+#define _GNU_SOURCE // syscall()
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
-#include <pthread.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <utils.h>
 #include <concurrentqueue.h>
 
-/*  Initialize a concurrent queue of size 'n'. 
+// Number of attempts on a full/empty queue before parking the thread
+#define SPIN_COUNT 128
+
+// Hint to the CPU that the thread is spinning
+static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/*  Wait on the futex 'addr' while it contains 'val', at most until 'abstime' of the CLOCK_MONOTONIC clock if not NULL.
+ *  errno is preserved.
+ *
+ *  RETURN VALUE: 0 on wake up
+ *                error number otherwise (ETIMEDOUT, EAGAIN, EINTR)
+ */
+static int futex_wait(unsigned int *addr, unsigned int val, const struct timespec *abstime) {
+    int errsv = errno, error_number = 0;
+
+    if (syscall(SYS_futex, addr, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, val, abstime, NULL, FUTEX_BITSET_MATCH_ANY) == -1)
+        error_number = errno;
+
+    errno = errsv;
+    return error_number;
+}
+
+// Wake up a thread waiting on the futex 'addr', errno is preserved
+static void futex_wake(unsigned int *addr) {
+    int errsv = errno;
+
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    errno = errsv;
+}
+
+/*  Initialize a concurrent queue of size 'n'.
  *
  *  RETURN VALUE: pointer to the new queue on success
  *                NULL on error (errno is set)
@@ -17,64 +58,40 @@ ConcurrentQueue_t *initConcurrentQueue(size_t n) {
         return NULL;
     }
 
-    // Allocate concurrent queue data structure
+    // Allocate concurrent queue data structure, aligned to the cache line
     ConcurrentQueue_t *q;
-    
-    if ((q = malloc(sizeof(ConcurrentQueue_t))) == NULL) {
-        int errsv = errno;
-	    fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
-        errno = errsv;
-        return NULL;
-    }
-
-    // Allocate filename array of size 'n'
-    if ((q->buf = malloc(sizeof(char*) * n)) == NULL) {
-        int errsv = errno;
-	    fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
-        free(q);
-        errno = errsv;
-        return NULL;
-    }
-
     int error_number;
-    
-    // Init queue mutex
-    if ((error_number = pthread_mutex_init(&q->mutex, NULL)) != 0) {
-	    fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_mutex_init()\n");
-        free(q->buf);
-        free(q);
-        errno = error_number;
-        return NULL;
-    }
 
-    // Init condition variable 'full' where the producers will be suspended
-        if ((error_number = pthread_cond_init(&q->cond_full, NULL)) != 0) {
-        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_cond_init() 'cond_full'\n");
-        pthread_mutex_destroy(&q->mutex);
-        free(q->buf);
-        free(q);
+    if ((error_number = posix_memalign((void**) &q, CACHE_LINE, sizeof(ConcurrentQueue_t))) != 0) {
+	    fprintf(stderr, "\x1B[1;31merror:\x1B[0m posix_memalign()\n");
         errno = error_number;
         return NULL;
     }
 
-    // Init condition variable 'empty' where the consumers will be suspended
-    if ((error_number = pthread_cond_init(&q->cond_empty, NULL)) != 0) {
-        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_cond_init() 'cond_empty'\n");
-        pthread_mutex_destroy(&q->mutex);
-        pthread_cond_destroy(&q->cond_full);
-        free(q->buf);
+    // Allocate slot array of size 'n'
+    if ((q->buf = malloc(sizeof(QueueSlot_t) * n)) == NULL) {
+        int errsv = errno;
+	    fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
         free(q);
-        errno = error_number;
+        errno = errsv;
         return NULL;
     }
 
-    // Init variables
+    // Init variables, slot i is free for the producer that claims position i
+    // 'seq' of a slot is 2 * pos when the slot is free for the producer of 'pos' and 2 * pos + 1 when it holds the task of 'pos',
+    // so the two states never collide even on a queue of size 1
     q->head = 0;
     q->tail = 0;
-    q->qlen = 0;
     q->qsize = n;
-    q->num_prod = 0;
-    q->num_cons = 0;
+    q->not_full = 0;
+    q->not_empty = 0;
+    q->prod_waiters = 0;
+    q->cons_waiters = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        q->buf[i].seq = 2 * i;
+        q->buf[i].task = NULL;
+    }
 
     // Return pointer to the concurrent queue
     return q;
@@ -83,104 +100,210 @@ ConcurrentQueue_t *initConcurrentQueue(size_t n) {
 // Delete a queue allocated with initConcurrentQueue() pointed to by q
 void deleteConcurrentQueue(ConcurrentQueue_t *q) {
     if (q != NULL) {
-        // Free all filenames if present
-	    while(q->head != q->tail) {
-            free(q->buf[q->head]);
-            q->head += ((q->head + 1) >= q->qsize) ? (1 - q->qsize) : 1;
+        // Delete all tasks if present
+        QueueSlot_t *slot;
+
+        while ((slot = &q->buf[q->head % q->qsize])->seq == 2 * q->head + 1) {
+            deleteTask(slot->task);
+            slot->seq = 2 * (q->head + q->qsize);
+            q->head++;
         }
 
         // Free resources in the queue data structure
-        pthread_mutex_destroy(&q->mutex);
-        pthread_cond_destroy(&q->cond_full);
-        pthread_cond_destroy(&q->cond_empty);
-        free(q->buf); 
-        
+        free(q->buf);
+
         // Free queue
         free(q);
     }
 }
 
-/*  Insert filename into the queue pointed to by q.
- * 
+/*  Insert task into the queue pointed to by q, if 'nowait' is not zero fail instead of waiting on a full queue.
+ *
  *  RETURN VALUE: 0 on success
  *                -1 on error (errno is set)
  */
-int pushConcurrentQueue(ConcurrentQueue_t *q, char filename[]) {
-    // Check arguments, filename 'NULL' allowed for the Worker thread termination protocol
+static int push(ConcurrentQueue_t *q, Task_t *task, int nowait) {
+    // Check arguments, task 'NULL' allowed for the Worker thread termination protocol
     if ((q == NULL)) {
         errno = EINVAL;
 	    return -1;
     }
 
-    int error_number;
+    QueueSlot_t *slot;
+    size_t pos, seq;
+    unsigned int not_full;
+    int spins = 0;
 
-    LOCK_RETURN(&q->mutex, error_number, -1)
+    // Claim a position
+    pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
 
-    // Increase the number of waiting producers
-    q->num_prod++;
+    while (1) {
+        slot = &q->buf[pos % q->qsize];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
 
-    // Wait if queue is full
-    while (q->qlen == q->qsize) {
-        WAIT_RETURN(&q->cond_full, &q->mutex, error_number, -1)
-    }
+        if (seq == 2 * pos) {
+            // Slot free, try to advance the tail
+            if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if ((intptr_t) (seq - 2 * pos) < 0) {
+            // Queue full, spin and then wait until a consumer frees the slot
+            if (nowait) {
+                errno = EAGAIN;
+                return -1;
+            } else if (spins < SPIN_COUNT) {
+                spins++;
+                cpu_relax();
+            } else {
+                not_full = __atomic_load_n(&q->not_full, __ATOMIC_ACQUIRE);
+                __atomic_add_fetch(&q->prod_waiters, 1, __ATOMIC_SEQ_CST);
+
+                if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) == seq)
+                    futex_wait(&q->not_full, not_full, NULL);
 
-    // Producer no longer waiting
-    q->num_prod--;
+                __atomic_sub_fetch(&q->prod_waiters, 1, __ATOMIC_SEQ_CST);
+            }
+
+            pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+        } else {
+            // Position claimed by another producer
+            pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+        }
+    }
 
-    // Insert filename in the queue
-    q->buf[q->tail] = filename;
-    q->tail += ((q->tail + 1) >= q->qsize) ? (1 - q->qsize) : 1;
-    q->qlen += 1;
+    // Insert task in the queue
+    slot->task = task;
+    __atomic_store_n(&slot->seq, 2 * pos + 1, __ATOMIC_RELEASE);
 
     // Signal any consumers
-    if (q->num_cons > 0)
-        SIGNAL_RETURN(&q->cond_empty, error_number, -1)  
+    __atomic_add_fetch(&q->not_empty, 1, __ATOMIC_SEQ_CST);
 
-    UNLOCK_RETURN(&q->mutex, error_number, -1)
+    if (__atomic_load_n(&q->cons_waiters, __ATOMIC_SEQ_CST) != 0)
+        futex_wake(&q->not_empty);
 
     // Success
     return 0;
 }
 
-/* Pull filename from the queue.
+/*  Insert task into the queue pointed to by q.
  *
- *  RETURN VALUE: pointer to the filename on success
- *                NULL on error (errno is set)
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int pushConcurrentQueue(ConcurrentQueue_t *q, Task_t *task) {
+    return push(q, task, 0);
+}
+
+/*  Insert task into the queue pointed to by q without waiting.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on full queue (errno is set to EAGAIN) or on error (errno is set)
  */
-char *popConcurrentQueue(ConcurrentQueue_t *q) {
+int tryPushConcurrentQueue(ConcurrentQueue_t *q, Task_t *task) {
+    return push(q, task, 1);
+}
+
+/* Pull task from the queue, if 'abstime' is not NULL wait at most until 'abstime', if 'nowait' is not zero do not wait.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on timeout or on error (errno is set)
+ */
+static Task_t *pop(ConcurrentQueue_t *q, const struct timespec *abstime, int nowait) {
     // Check queue pointer
     if (q == NULL) {
         errno = EINVAL;
 	    return NULL;
     }
 
-    int error_number;
+    QueueSlot_t *slot;
+    size_t pos, seq;
+    unsigned int not_empty;
+    int spins = 0, expired = 0;
 
-    LOCK_RETURN(&q->mutex, error_number, NULL)
+    // Claim a position
+    pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
 
-    // Increase the number of waiting consumers
-    q->num_cons++;
+    while (1) {
+        slot = &q->buf[pos % q->qsize];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
 
-    // Wait if queue is empty
-    while (q->qlen == 0) {
-        WAIT_RETURN(&q->cond_empty, &q->mutex, error_number, NULL)
-    }
+        if (seq == 2 * pos + 1) {
+            // Task published, try to advance the head
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if ((intptr_t) (seq - (2 * pos + 1)) < 0) {
+            // Queue empty after the timeout, the consumer gives up
+            if (expired) {
+                errno = ETIMEDOUT;
+                return NULL;
+            } else if (nowait) {
+                errno = EAGAIN;
+                return NULL;
+            }
+
+            // Queue empty, spin and then wait until a producer publishes the slot
+            if (spins < SPIN_COUNT) {
+                spins++;
+                cpu_relax();
+            } else {
+                not_empty = __atomic_load_n(&q->not_empty, __ATOMIC_ACQUIRE);
+                __atomic_add_fetch(&q->cons_waiters, 1, __ATOMIC_SEQ_CST);
+
+                // On timeout the queue is checked one last time
+                if ((__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) == seq) && (futex_wait(&q->not_empty, not_empty, abstime) == ETIMEDOUT))
+                    expired = 1;
 
-    // Consumer no longer waiting
-    q->num_cons--;
+                __atomic_sub_fetch(&q->cons_waiters, 1, __ATOMIC_SEQ_CST);
+            }
 
-    // Remove filename from the queue
-    char *filename = q->buf[q->head];
-    q->buf[q->head] = NULL;
-    q->head += ((q->head + 1) >= q->qsize) ? (1 - q->qsize) : 1;
-    q->qlen -= 1;
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        } else {
+            // Position claimed by another consumer
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    // Remove task from the queue, the slot is free for the producer of the next round
+    Task_t *task = slot->task;
+    __atomic_store_n(&slot->seq, 2 * (pos + q->qsize), __ATOMIC_RELEASE);
 
     // Signal any producers
-    if (q->num_prod > 0)
-        SIGNAL_RETURN(&q->cond_full, error_number, NULL)  
-    
-    UNLOCK_RETURN(&q->mutex, error_number, NULL)
-    
-    return filename;
-} 
+    __atomic_add_fetch(&q->not_full, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&q->prod_waiters, __ATOMIC_SEQ_CST) != 0)
+        futex_wake(&q->not_full);
+
+    return task;
+}
+
+/* Pull task from the queue.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on error (errno is set)
+ */
+Task_t *popConcurrentQueue(ConcurrentQueue_t *q) {
+    return pop(q, NULL, 0);
+}
 
+/* Pull task from the queue, waiting at most until the absolute time 'abstime' of the CLOCK_MONOTONIC clock.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on timeout (errno is set to ETIMEDOUT) or on error (errno is set)
+ */
+Task_t *timedPopConcurrentQueue(ConcurrentQueue_t *q, const struct timespec *abstime) {
+    // Check time pointer
+    if (abstime == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return pop(q, abstime, 0);
+}
+
+/* Pull task from the queue without waiting.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on empty queue (errno is set to EAGAIN) or on error (errno is set)
+ */
+Task_t *tryPopConcurrentQueue(ConcurrentQueue_t *q) {
+    return pop(q, NULL, 1);
+}
@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 200112L // posix_memalign()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <utils.h>
+#include <deque.h>
+
+/*  Initialize a deque of at least 'n' tasks.
+ *
+ *  RETURN VALUE: pointer to the new deque on success
+ *                NULL on error (errno is set)
+ */
+Deque_t *initDeque(size_t n) {
+    // Check size
+    if (n == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Allocate deque data structure, aligned to the cache line
+    Deque_t *d;
+    int error_number;
+
+    if ((error_number = posix_memalign((void**) &d, CACHE_LINE, sizeof(Deque_t))) != 0) {
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m posix_memalign()\n");
+        errno = error_number;
+        return NULL;
+    }
+
+    // The size of the array is a power of 2
+    size_t size = 1;
+
+    while (size < n) size <<= 1;
+
+    // Allocate task array
+    if ((d->buf = malloc(sizeof(Task_t*) * size)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
+        free(d);
+        errno = errsv;
+        return NULL;
+    }
+
+    // Init variables
+    d->top = 0;
+    d->bottom = 0;
+    d->mask = size - 1;
+
+    // Return pointer to the deque
+    return d;
+}
+
+// Delete a deque allocated with initDeque() pointed to by d, the remaining tasks are deleted
+void deleteDeque(Deque_t *d) {
+    if (d != NULL) {
+        // Delete all tasks if present
+        for (long i = d->top; i < d->bottom; i++)
+            deleteTask(d->buf[i & d->mask]);
+
+        free(d->buf);
+        free(d);
+    }
+}
+
+/*  Insert 'task' at the bottom of the deque pointed to by d, only the owner thread.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set to EAGAIN if the deque is full)
+ */
+int pushDeque(Deque_t *d, Task_t *task) {
+    // Check arguments
+    if ((d == NULL) || (task == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+    // Check if the deque is full
+    if (b - t > d->mask) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    // Publish the task before the new bottom
+    __atomic_store_n(&d->buf[b & d->mask], task, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+
+    // Success
+    return 0;
+}
+
+/*  Pull a task from the bottom of the deque pointed to by d, only the owner thread.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL if the deque is empty
+ */
+Task_t *popDeque(Deque_t *d) {
+    // Reserve the bottom task, then check the thieves
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    long t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    Task_t *task = NULL;
+
+    if (t <= b) {
+        task = __atomic_load_n(&d->buf[b & d->mask], __ATOMIC_RELAXED);
+
+        // Last task, race with the thieves
+        if (t == b) {
+            if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                task = NULL;
+
+            __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        // Empty deque
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+
+    return task;
+}
+
+/*  Steal a task from the top of the deque pointed to by d, any thread.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL if the deque is empty or the task was taken by another thread
+ */
+Task_t *stealDeque(Deque_t *d) {
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+    if (t >= b) return NULL;
+
+    Task_t *task = __atomic_load_n(&d->buf[t & d->mask], __ATOMIC_RELAXED);
+
+    // Race with the owner and the other thieves
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+
+    return task;
+}
+
+// Number of tasks in the deque pointed to by d, for the owner thread an upper bound (thieves only remove tasks)
+size_t sizeDeque(Deque_t *d) {
+    long size = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    return (size > 0) ? size : 0;
+}
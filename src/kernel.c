@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <kernel.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNEL_X86
+#endif
+
+/*  All the variants accumulate with unsigned arithmetic, so that overflows wrap around
+ *  modulo 2^64 exactly like the original scalar loop, whatever the order of the additions.
+ */
+
+// Scalar variant, always supported
+static int supported_scalar() {
+    return 1;
+}
+
+static long weighted_sum_scalar(const long numbers[], size_t n, long base) {
+    unsigned long result = 0, i = (unsigned long) base;
+
+    for (size_t j = 0; j < n; j++, i++)
+        result += i * (unsigned long) numbers[j];
+
+    return (long) result;
+}
+
+#ifdef KERNEL_X86
+
+/* -------------------- SSE2 variant: 2 lanes of 64 bits -------------------- */
+
+// Three 32 x 32 -> 64 bit multiplications for two products are slower than the scalar loop, the variant is only compared by kernelbench
+static int supported_sse2() {
+    return __builtin_cpu_supports("sse2");
+}
+
+// Low 64 bits of the lane-wise product, SSE2 only has the 32 x 32 -> 64 bit multiplication
+__attribute__((target("sse2")))
+static inline __m128i mullo_epi64_sse2(__m128i a, __m128i b) {
+    __m128i lo = _mm_mul_epu32(a, b);
+    __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+
+    return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+}
+
+__attribute__((target("sse2")))
+static long weighted_sum_sse2(const long numbers[], size_t n, long base) {
+    // Index vector {base, base + 1} and its increment
+    __m128i index = _mm_set_epi64x(base + 1, base);
+    __m128i step = _mm_set1_epi64x(2);
+    __m128i acc = _mm_setzero_si128();
+    size_t j = 0;
+
+    for (; j + 2 <= n; j += 2) {
+        acc = _mm_add_epi64(acc, mullo_epi64_sse2(index, _mm_loadu_si128((const __m128i*) &numbers[j])));
+        index = _mm_add_epi64(index, step);
+    }
+
+    // Reduce the lanes
+    unsigned long lanes[2];
+    _mm_storeu_si128((__m128i*) lanes, acc);
+
+    return (long) (lanes[0] + lanes[1] + (unsigned long) weighted_sum_scalar(&numbers[j], n - j, base + j));
+}
+
+/* -------------------- AVX2 variant: 4 lanes of 64 bits -------------------- */
+
+static int supported_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+// Low 64 bits of the lane-wise product, AVX2 only has the 32 x 32 -> 64 bit multiplication
+__attribute__((target("avx2")))
+static inline __m256i mullo_epi64_avx2(__m256i a, __m256i b) {
+    __m256i lo = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx2")))
+static long weighted_sum_avx2(const long numbers[], size_t n, long base) {
+    // Two independent accumulators hide the latency of the emulated multiplication
+    __m256i index0 = _mm256_set_epi64x(base + 3, base + 2, base + 1, base);
+    __m256i index1 = _mm256_add_epi64(index0, _mm256_set1_epi64x(4));
+    __m256i step = _mm256_set1_epi64x(8);
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t j = 0;
+
+    for (; j + 8 <= n; j += 8) {
+        acc0 = _mm256_add_epi64(acc0, mullo_epi64_avx2(index0, _mm256_loadu_si256((const __m256i*) &numbers[j])));
+        acc1 = _mm256_add_epi64(acc1, mullo_epi64_avx2(index1, _mm256_loadu_si256((const __m256i*) &numbers[j + 4])));
+        index0 = _mm256_add_epi64(index0, step);
+        index1 = _mm256_add_epi64(index1, step);
+    }
+
+    // Reduce the lanes
+    unsigned long lanes[4];
+    _mm256_storeu_si256((__m256i*) lanes, _mm256_add_epi64(acc0, acc1));
+
+    return (long) (lanes[0] + lanes[1] + lanes[2] + lanes[3] + (unsigned long) weighted_sum_scalar(&numbers[j], n - j, base + j));
+}
+
+/* -------------------- AVX-512 variant: 8 lanes of 64 bits -------------------- */
+
+static int supported_avx512() {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static long weighted_sum_avx512(const long numbers[], size_t n, long base) {
+    __m512i index0 = _mm512_add_epi64(_mm512_set1_epi64(base), _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+    __m512i index1 = _mm512_add_epi64(index0, _mm512_set1_epi64(8));
+    __m512i step = _mm512_set1_epi64(16);
+    __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+    size_t j = 0;
+
+    for (; j + 16 <= n; j += 16) {
+        acc0 = _mm512_add_epi64(acc0, _mm512_mullo_epi64(index0, _mm512_loadu_si512(&numbers[j])));
+        acc1 = _mm512_add_epi64(acc1, _mm512_mullo_epi64(index1, _mm512_loadu_si512(&numbers[j + 8])));
+        index0 = _mm512_add_epi64(index0, step);
+        index1 = _mm512_add_epi64(index1, step);
+    }
+
+    // Reduce the lanes
+    unsigned long result = (unsigned long) _mm512_reduce_add_epi64(_mm512_add_epi64(acc0, acc1));
+
+    return (long) (result + (unsigned long) weighted_sum_scalar(&numbers[j], n - j, base + j));
+}
+
+#endif /* KERNEL_X86 */
+
+// Kernel variants, from the most portable to the most specific
+const Kernel_t kernels[] = {
+    { "scalar", supported_scalar, weighted_sum_scalar, 1 },
+#ifdef KERNEL_X86
+    { "sse2", supported_sse2, weighted_sum_sse2, 0 },
+    { "avx2", supported_avx2, weighted_sum_avx2, 1 },
+    { "avx512", supported_avx512, weighted_sum_avx512, 1 },
+#endif
+};
+
+const int n_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+// Selected kernel variant
+static const Kernel_t *kernel = &kernels[0];
+
+// Select the fastest kernel variant supported by the CPU among the dispatched ones, it is called once at startup
+void initKernel() {
+#ifdef KERNEL_X86
+    __builtin_cpu_init();
+#endif
+
+    for (int i = n_kernels - 1; i >= 0; i--) {
+        if (kernels[i].dispatched && kernels[i].supported()) {
+            kernel = &kernels[i];
+            break;
+        }
+    }
+}
+
+// Return the name of the selected kernel variant
+const char *nameKernel() {
+    return kernel->name;
+}
+
+/*  Calculate the sum of (base + j) * numbers[j] for j in [0, n) with the selected kernel variant.
+ *  Overflows wrap around, all the variants return the same result of the scalar loop.
+ *
+ *  RETURN VALUE: the weighted sum
+ */
+long weightedSum(const long numbers[], size_t n, long base) {
+    return kernel->weighted_sum(numbers, n, base);
+}
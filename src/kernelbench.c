@@ -0,0 +1,108 @@
+#define _GNU_SOURCE // rand_r(), clock_gettime()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <kernel.h>
+
+// Minimum measured time for each kernel variant and buffer size
+#define MIN_TIME_NS 200000000L
+
+// Return the current time in nanoseconds
+static long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// Fill 'numbers' like the generafile program does
+static void fill_generafile(long numbers[], size_t n) {
+    unsigned int seed = 331777;
+
+    for (size_t i = 0; i < n; i++)
+        numbers[i] = (long) (rand_r(&seed) / 12345678.0);
+}
+
+// Fill 'numbers' with values spanning the whole range of long, so that the sum wraps around
+static void fill_wrapping(long numbers[], size_t n) {
+    unsigned long x = 88172645463325252UL;
+
+    for (size_t i = 0; i < n; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        numbers[i] = (long) x;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Buffer sizes in elements, from the files of the test suite up to multi-MB files
+    size_t sizes[] = { 117, 1000, 4096, 65536, 1048576, 16777216 };
+    int n_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    if (argc > 1) {
+        fprintf(stderr, "Usage: %s\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    long *numbers;
+
+    if ((numbers = malloc(sizeof(long) * sizes[n_sizes - 1])) == NULL) {
+        perror("malloc()");
+        return EXIT_FAILURE;
+    }
+
+    initKernel();
+    printf("selected kernel: %s\n\n", nameKernel());
+
+    // Check that all the variants return the same result of the scalar loop, with and without wrap around
+    int failed = 0;
+
+    for (int f = 0; f < 2; f++) {
+        if (f == 0) fill_wrapping(numbers, sizes[n_sizes - 1]);
+        else fill_generafile(numbers, sizes[n_sizes - 1]);
+
+        for (int s = 0; s < n_sizes; s++) {
+            for (size_t n = sizes[s] - 3; n <= sizes[s]; n++) {
+                long expected = kernels[0].weighted_sum(numbers, n, 5);
+
+                for (int k = 1; k < n_kernels; k++) {
+                    if (kernels[k].supported() && (kernels[k].weighted_sum(numbers, n, 5) != expected)) {
+                        fprintf(stderr, "%s: mismatch on %zu elements\n", kernels[k].name, n);
+                        failed = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (failed) {
+        free(numbers);
+        return EXIT_FAILURE;
+    }
+
+    // Measure the throughput of every variant
+    printf("%-10s %12s %12s %12s\n", "kernel", "elements", "ns/elem", "GB/s");
+
+    for (int s = 0; s < n_sizes; s++) {
+        for (int k = 0; k < n_kernels; k++) {
+            if (!kernels[k].supported()) {
+                printf("%-10s %12zu %12s %12s\n", kernels[k].name, sizes[s], "-", "-");
+                continue;
+            }
+
+            volatile long sink = 0;
+            long iterations = 0, start = now_ns(), elapsed;
+
+            do {
+                sink += kernels[k].weighted_sum(numbers, sizes[s], 0);
+                iterations++;
+            } while ((elapsed = now_ns() - start) < MIN_TIME_NS);
+
+            double ns_elem = (double) elapsed / ((double) iterations * sizes[s]);
+            printf("%-10s %12zu %12.3f %12.2f\n", kernels[k].name, sizes[s], ns_elem, sizeof(long) / ns_elem);
+        }
+    }
+
+    free(numbers);
+    return EXIT_SUCCESS;
+}
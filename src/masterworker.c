@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/types.h>
@@ -10,26 +11,79 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <dirent.h>
 #include <signal.h>
 #include <time.h>
 #include <utils.h>
 #include <queue.h>
 #include <threadpool.h>
+#include <shmring.h>
+#include <pathtable.h>
+#include <uring.h>
+#include <cache.h>
+#include <watch.h>
 #include <collector.h>
+#include <stream.h>
+#include <scanner.h>
 
 // Default options
 #define POOL_SIZE 4
 #define QUEUE_SIZE 8
 #define DELAY 0
+#define CHUNK_SIZE (64 * 1024 * 1024)
+#define SCAN_THREADS 0
+#define COLLECTOR_THREADS 1
+#define URING_DEPTH 8
 #define PATHNAME_MAX 255
 
+// Number of filenames the stream of the scan holds before the scanner threads wait for the Master thread
+#define STREAM_SIZE 4096
+
+// Maximum time in milliseconds the Master thread waits for the stream of the scan before checking the termination flag
+#define STREAM_POLL 100
+
+// Number of slots of the shared memory ring between the Worker threads and the Collector process
+#define RING_SLOTS 1024
+
+// File descriptors left to the sockets, the files and the directories besides the channels of the socket transport
+#define RESERVED_FDS 64
+
+// Transport of the results from the Worker threads to the Collector process
+typedef enum Transport {
+    TRANSPORT_SHM,      // Shared memory ring
+    TRANSPORT_SOCKET    // A UNIX socket channel for each Worker thread
+} Transport_t;
+
+// Dispatch of the FILEs of the 'dirname' directory to the Worker threads
+typedef enum Dispatch {
+    DISPATCH_BATCH,     // After the whole scan
+    DISPATCH_STREAM     // While the scan is running
+} Dispatch_t;
+
+// Arguments of the thread running the scan of the streaming dispatch
+typedef struct StreamScan {
+    char *dirname;
+    FileStream_t *stream;
+    size_t n_threads;
+    char *progname;
+} StreamScan_t;
+
 // Socket of Master process used to accept the connection request of the Collector process
 static int sfd;
 
 // Connection socket with the Collector process
 static int cfd;
 
+// Shared memory ring with the Collector process, NULL if not available
+static ShmRing_t *ring = NULL;
+
+// Table of the paths shared with the Collector process, the results refer to the files by their ID in it
+static PathTable_t *paths = NULL;
+
+// Results of the files found in the cache, sent in batches on the channel of the Master thread with the socket transport
+static ResultBatch_t hits;
+
 // Termination flag
 static volatile sig_atomic_t sigexit = 0;
 
@@ -56,10 +110,13 @@ static void sanitize_filename(char filename[], int last);
 // Search recursively inside 'dirname' directory, valid files, and put them in the 'requests' queue
 static void read_dir(char dirname[], Queue_t *requests, char progname[]);
 
+// Thread running the scan of the streaming dispatch, the files found are appended to the stream until the end of the scan
+static void *stream_scan_thread(void *arg);
+
 // Signal handler established for signal SIGHUP, SIGINT, SIGQUIT, SIGTERM
 static void sigexit_handler(int signo);
 
-// Signal handler thread, send print command to Collector process when signal SIGUSR1 is caught
+// Signal handler thread, send print command to Collector process when signal SIGUSR1 or SIGUSR2 is caught
 static void *sigprint_handler_thread(void *arg);
 
 int main(int argc, char *argv[]) {
@@ -72,6 +129,7 @@ int main(int argc, char *argv[]) {
     sigaddset(&mask, SIGQUIT);
     sigaddset(&mask, SIGTERM);
     sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGUSR2);
 
     int error_number;
     
@@ -122,6 +180,18 @@ int main(int argc, char *argv[]) {
         exit(errsv);
     }
 
+    // Create the shared memory ring before fork(), on error results are sent with the socket transport
+    ring = initShmRing(RING_SLOTS);
+
+    // Create the table of the paths before fork(), the Master thread adds each file before submitting it
+    if ((paths = initPathTable(PATHTABLE_SIZE)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m initPathTable(): %s\n", argv[0], strerror(errsv));
+        unlink(SOCK_PATHNAME);
+        close(sfd);
+        exit(errsv);
+    }
+
     // Create Collector process
     pid_t cpid;
 
@@ -140,7 +210,7 @@ int main(int argc, char *argv[]) {
         close(sfd);
 
         // Exec main function
-        exec_collector();
+        exec_collector(ring, paths);
     } else {
         // Master process
 
@@ -156,14 +226,25 @@ int main(int argc, char *argv[]) {
         if (atexit(cleanup) != 0) {
             fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m atexit()\n", argv[0]);
             unlink(SOCK_PATHNAME);
+            deleteShmRing(ring);
+            deletePathTable(paths);
             close(cfd);
             close(sfd);
             exit(EXIT_FAILURE);
         }
 
         // Init variables
-        long pool_size = POOL_SIZE, queue_size = QUEUE_SIZE, delay = DELAY;
-        char *dirname = NULL;
+        long pool_size = POOL_SIZE, queue_size = QUEUE_SIZE, delay = DELAY, chunk_size = CHUNK_SIZE, scan_threads = SCAN_THREADS, top_k = 0, memory_max = 0;
+        long collector_threads = COLLECTOR_THREADS, uring_depth = URING_DEPTH;
+        ReadEngine_t engine = ENGINE_AUTO;
+        Transport_t transport = TRANSPORT_SHM;
+        Scheduler_t scheduler = SCHEDULER_SHARED;
+        Dispatch_t dispatch = DISPATCH_BATCH;
+        QueueOrder_t policy = QUEUE_FIFO;
+        Output_t output_format = OUTPUT_TEXT;
+        char *dirname = NULL, *cache_pathname = NULL;
+        int cache_refresh = 0, watch_mode = 0;
+        Incremental_t incremental = INCREMENTAL_OFF;
 
         // Check if there are no arguments
         if (argc == 1) {
@@ -176,8 +257,9 @@ int main(int argc, char *argv[]) {
         extern int optopt;
         int opt, errsv;
         struct stat statbuf;
+        FileKey_t key;
 
-        while ((opt = getopt(argc, argv, ":n:q:t:d:h")) != -1) {
+        while ((opt = getopt(argc, argv, ":n:q:t:d:r:u:c:T:s:S:m:p:x:Xi:wk:K:M:C:o:h")) != -1) {
             switch (opt) {
                 case 'n':
                     if ((isNumber(optarg, &pool_size) != 0) || (pool_size < 1)) {
@@ -226,6 +308,148 @@ int main(int argc, char *argv[]) {
                     else
                         dirname = optarg;
                     break;
+                case 'r':
+                    if (strcmp(optarg, "auto") == 0) {
+                        engine = ENGINE_AUTO;
+                    } else if (strcmp(optarg, "stdio") == 0) {
+                        engine = ENGINE_STDIO;
+                    } else if (strcmp(optarg, "mmap") == 0) {
+                        engine = ENGINE_MMAP;
+                    } else if (strcmp(optarg, "uring") == 0) {
+                        engine = ENGINE_URING;
+                    } else {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'r'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'u':
+                    if ((isNumber(optarg, &uring_depth) != 0) || (uring_depth < 1) || (uring_depth > 4096)) {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'u'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'c':
+                    if ((isNumber(optarg, &chunk_size) != 0) || (chunk_size < 0)) {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'c'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'T':
+                    if (strcmp(optarg, "shm") == 0) {
+                        transport = TRANSPORT_SHM;
+                    } else if (strcmp(optarg, "socket") == 0) {
+                        transport = TRANSPORT_SOCKET;
+                    } else {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'T'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 's':
+                    if (strcmp(optarg, "shared") == 0) {
+                        scheduler = SCHEDULER_SHARED;
+                    } else if (strcmp(optarg, "rr") == 0) {
+                        scheduler = SCHEDULER_RR;
+                    } else if (strcmp(optarg, "locality") == 0) {
+                        scheduler = SCHEDULER_LOCALITY;
+                    } else {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 's'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'S':
+                    if ((isNumber(optarg, &scan_threads) != 0) || (scan_threads < 0)) {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'S'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'm':
+                    if (strcmp(optarg, "batch") == 0) {
+                        dispatch = DISPATCH_BATCH;
+                    } else if (strcmp(optarg, "stream") == 0) {
+                        dispatch = DISPATCH_STREAM;
+                    } else {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'm'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'p':
+                    if (strcmp(optarg, "fifo") == 0) {
+                        policy = QUEUE_FIFO;
+                    } else if (strcmp(optarg, "lpt") == 0) {
+                        policy = QUEUE_LARGEST;
+                    } else if (strcmp(optarg, "sjf") == 0) {
+                        policy = QUEUE_SMALLEST;
+                    } else {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'p'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'x':
+                    cache_pathname = optarg;
+                    break;
+                case 'X':
+                    cache_refresh = 1;
+                    break;
+                case 'w':
+                    watch_mode = 1;
+                    break;
+                case 'i':
+                    if (strcmp(optarg, "off") == 0) {
+                        incremental = INCREMENTAL_OFF;
+                    } else if (strcmp(optarg, "append") == 0) {
+                        incremental = INCREMENTAL_APPEND;
+                    } else if (strcmp(optarg, "verify") == 0) {
+                        incremental = INCREMENTAL_VERIFY;
+                    } else {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'i'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'k':
+                case 'K':
+                    if ((isNumber(optarg, &top_k) != 0) || (top_k < 1) || (top_k > INT_MAX)) {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- '%c'\n", argv[0], opt);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+
+                    // The largest results are requested with a negative number
+                    if (opt == 'K') top_k = -top_k;
+                    break;
+                case 'M':
+                    if ((isNumber(optarg, &memory_max) != 0) || (memory_max < 0)) {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'M'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'C':
+                    if ((isNumber(optarg, &collector_threads) != 0) || (collector_threads < 1) || (collector_threads > INT_MAX)) {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'C'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
+                case 'o':
+                    if (strcmp(optarg, "text") == 0) {
+                        output_format = OUTPUT_TEXT;
+                    } else if (strcmp(optarg, "binary") == 0) {
+                        output_format = OUTPUT_BINARY;
+                    } else {
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m invalid option argument -- 'o'\n", argv[0]);
+                        info(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                    break;
                 case 'h':
                     // Print help message
                     usage();
@@ -251,10 +475,23 @@ int main(int argc, char *argv[]) {
             exit(EXIT_FAILURE);
         }
 
-        // Create queue where storing all filenames
+        // The watch mode keeps a result for each file of the 'dirname' directory, updated when the file changes
+        if (watch_mode && (dirname == NULL)) {
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m option requires option -d -- 'w'\n", argv[0]);
+            info(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+
+        if (watch_mode && ((top_k != 0) || (memory_max != 0))) {
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m option cannot be used with -k, -K or -M -- 'w'\n", argv[0]);
+            info(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+
+        // Create queue where storing all filenames, sorted by size if requested by the policy
         Queue_t *requests;
 
-        if ((requests = initQueue()) == NULL) {
+        if ((requests = initQueue(policy)) == NULL) {
             errsv = errno;
             fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m initQueue(): %s\n", argv[0], strerror(errsv));
             exit(errsv);
@@ -297,7 +534,9 @@ int main(int argc, char *argv[]) {
             }
 
             // Insert filename in the 'requests' queue
-            if (pushQueue(requests, argv[optind]) == -1) {
+            keyFile(&key, &statbuf);
+
+            if (pushQueue(requests, argv[optind], &key) == -1) {
                 errsv = errno;
                 fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pushQueue() '%s': %s\n", argv[0], argv[optind], strerror(errsv)); 
                 deleteQueue(requests);
@@ -307,71 +546,213 @@ int main(int argc, char *argv[]) {
             optind++;
         }
 
-        // Search inside 'dirname' directory, valid files, and put them in the 'requests' queue
-        if (dirname != NULL) read_dir(dirname, requests, argv[0]);
+        // Watch the 'dirname' directory tree before the scan, the files arriving during the scan are not missed
+        Watch_t *watch = NULL;
 
-        // Check if there are no files
-        int n_results;
+        if (watch_mode && ((watch = initWatch(dirname, PATHNAME_MAX, argv[0])) == NULL)) {
+            errsv = errno;
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m initWatch() '%s': %s\n", argv[0], dirname, strerror(errsv));
+            deleteQueue(requests);
+            exit(errsv);
+        }
+
+        // Search inside 'dirname' directory, valid files, and put them in the 'requests' queue
+        // with a pool of scanner threads if requested, the streaming dispatch scans it later while the Worker threads compute
+        if ((dirname != NULL) && (dispatch == DISPATCH_BATCH)) {
+            if (scan_threads == 0) {
+                read_dir(dirname, requests, argv[0]);
+            } else if (scanDirectory(dirname, requests, NULL, scan_threads, PATHNAME_MAX, argv[0]) == -1) {
+                errsv = errno;
+                deleteQueue(requests);
+                exit(errsv);
+            }
+        }
 
-        if ((n_results = lengthQueue(requests)) == 0) {
+        // Check if there are no files, the Collector process terminates without any result
+        // In watch mode the files may arrive later
+        if ((lengthQueue(requests) == 0) && ((dirname == NULL) || (dispatch == DISPATCH_BATCH)) && (watch == NULL)) {
             info(argv[0]);
             deleteQueue(requests);
             exit(EXIT_FAILURE);
         }
 
-        // Send the number of filenames to Collector process
-        if (writen(cfd, &n_results, sizeof(int)) == -1) {
+        // Send the number of results to keep to Collector process
+        int n_kept = top_k;
+
+        if (writen(cfd, &n_kept, sizeof(int)) == -1) {
+            errsv = errno;
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m writen() 'top_k': %s\n", argv[0], strerror(errsv)); 
+            deleteQueue(requests);
+            exit(errsv);
+        }
+
+        // Send the memory cap of the results to Collector process
+        if (writen(cfd, &memory_max, sizeof(long)) == -1) {
             errsv = errno;
-            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m writen() 'n_results': %s\n", argv[0], strerror(errsv)); 
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m writen() 'memory_max': %s\n", argv[0], strerror(errsv)); 
             deleteQueue(requests);
             exit(errsv);
         }
 
-        // Create and init 'collector_fd_mutex' to ensure thread safety on 'cfd' socket
-        pthread_mutex_t *collector_fd_mutex;
+        // Send the number of threads sorting and printing the results to Collector process
+        int n_collector_threads = collector_threads;
 
-        if ((collector_fd_mutex = malloc(sizeof(pthread_mutex_t))) == NULL) {
+        if (writen(cfd, &n_collector_threads, sizeof(int)) == -1) {
             errsv = errno;
-            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m malloc(): %s\n", argv[0], strerror(errsv)); 
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m writen() 'collector_threads': %s\n", argv[0], strerror(errsv)); 
             deleteQueue(requests);
             exit(errsv);
         }
 
-        if ((error_number = pthread_mutex_init(collector_fd_mutex, NULL)) != 0) {
-            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_mutex_init(): %s\n", argv[0], strerror(error_number)); 
+        // Send the output format to Collector process
+        int format = output_format;
+
+        if (writen(cfd, &format, sizeof(int)) == -1) {
+            errsv = errno;
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m writen() 'output_format': %s\n", argv[0], strerror(errsv)); 
             deleteQueue(requests);
-            free(collector_fd_mutex);
-            exit(error_number);
+            exit(errsv);
         }
 
+        // Send to Collector process if a new result of a file replaces its previous one, in watch mode
+        if (writen(cfd, &watch_mode, sizeof(int)) == -1) {
+            errsv = errno;
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m writen() 'replace': %s\n", argv[0], strerror(errsv)); 
+            deleteQueue(requests);
+            exit(errsv);
+        }
+
+        // Fall back to the socket transport if the shared memory ring is not available
+        if ((transport == TRANSPORT_SHM) && (ring == NULL)) {
+            fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m shared memory ring not available, using the socket transport\n", argv[0]);
+            transport = TRANSPORT_SOCKET;
+        }
+
+        // Fall back to the auto engine if io_uring is not available
+        if (engine == ENGINE_URING) {
+            Uring_t uring;
+
+            if (initUring(&uring, uring_depth) == -1) {
+                fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m io_uring not available (%s), using the auto engine\n", argv[0], strerror(errno));
+                engine = ENGINE_AUTO;
+            } else {
+                deleteUring(&uring);
+            }
+        }
+
+        // Open the cache of the results, without it every FILE is read
+        ResultCache_t *cache = NULL;
+
+        if ((cache_pathname != NULL) && ((cache = openCache(cache_pathname, cache_refresh, incremental)) == NULL))
+            fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m cache '%s' not available (%s), the results are not cached\n", argv[0], cache_pathname, strerror(errno));
+
+        // The Master and the Collector process hold an end of each channel, both must stay within the limit of open files
+        long n_channels = pool_size + (cache != NULL);
+        struct rlimit nofile;
+
+        if ((transport == TRANSPORT_SOCKET) && (getrlimit(RLIMIT_NOFILE, &nofile) == 0) && (nofile.rlim_cur != RLIM_INFINITY) &&
+            ((rlim_t) n_channels + RESERVED_FDS > nofile.rlim_cur)) {
+            if (ring == NULL) {
+                fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m %ld channels with the Collector process exceed the limit of %ld open files\n",
+                        argv[0], n_channels, (long) nofile.rlim_cur - RESERVED_FDS);
+                deleteQueue(requests);
+                exit(EMFILE);
+            }
+
+            fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m %ld channels exceed the limit of open files, using the shm transport\n", argv[0], n_channels);
+            transport = TRANSPORT_SHM;
+        }
+
+        // Create a channel with the Collector process for each Worker thread, so they never contend on 'cfd'
+        // The Master thread has its own channel for the results found in the cache
+        int *collector_fds = NULL, channel[2], opcode = OPCODE_CHANNEL;
+
+        if ((transport == TRANSPORT_SOCKET) && ((collector_fds = malloc(sizeof(int) * n_channels)) == NULL)) {
+            errsv = errno;
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m malloc(): %s\n", argv[0], strerror(errsv)); 
+            deleteQueue(requests);
+            exit(errsv);
+        }
+
+        for (long i = 0; (transport == TRANSPORT_SOCKET) && (i < n_channels); i++) {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) == -1) {
+                errsv = errno;
+                fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m socketpair(): %s\n", argv[0], strerror(errsv)); 
+                deleteQueue(requests);
+                exit(errsv);
+            }
+
+            // Pass the Collector side of the channel to the Collector process
+            if (sendfd(cfd, &opcode, sizeof(int), channel[1]) == -1) {
+                errsv = errno;
+                fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m sendfd() 'opcode: -3 (channel)': %s\n", argv[0], strerror(errsv)); 
+                deleteQueue(requests);
+                exit(errsv);
+            }
+
+            close(channel[1]);
+            collector_fds[i] = channel[0];
+        }
+
+        int master_fd = ((transport == TRANSPORT_SOCKET) && (cache != NULL)) ? collector_fds[pool_size] : -1;
+        ShmRing_t *hit_ring = (transport == TRANSPORT_SHM) ? ring : NULL;
+
         // Create thread pool
-        Threadpool_t *pool;
-        
-        if ((pool = initThreadPool(pool_size, queue_size, cfd, collector_fd_mutex)) == NULL) {
+        Threadpool_t *pool = initThreadPool(pool_size, queue_size, chunk_size, engine, uring_depth, scheduler, collector_fds, (transport == TRANSPORT_SHM) ? ring : NULL);
+
+        // The Worker threads own their channels
+        free(collector_fds);
+
+        if (pool == NULL) {
             errsv = errno;
             fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m initThreadPool(): %s\n", argv[0], strerror(errsv)); 
             deleteQueue(requests);
-            pthread_mutex_destroy(collector_fd_mutex);
-            free(collector_fd_mutex);
             exit(errsv);
         }
 
         // Spawn signal handler thread
         pthread_t sigprint_handler_tid;
 
-        if((error_number = pthread_create(&sigprint_handler_tid, NULL, sigprint_handler_thread, collector_fd_mutex)) != 0) {
+        if((error_number = pthread_create(&sigprint_handler_tid, NULL, sigprint_handler_thread, NULL)) != 0) {
             errsv = errno;
             fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_create() 'sigprint_handler_thread': %s\n", argv[0], strerror(errsv)); 
             deleteQueue(requests);
             shutdownThreadPool(pool);
-            pthread_mutex_destroy(collector_fd_mutex);
-            free(collector_fd_mutex);
             exit(errsv);
         }
 
+        // Start the scan of the streaming dispatch, the scanner threads inherit the blocked signals
+        FileStream_t *stream = NULL;
+        StreamScan_t stream_scan;
+        pthread_t stream_scan_tid;
+
+        if ((dirname != NULL) && (dispatch == DISPATCH_STREAM)) {
+            if ((stream = initStream(STREAM_SIZE, policy)) == NULL) {
+                errsv = errno;
+                fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m initStream(): %s\n", argv[0], strerror(errsv)); 
+                deleteQueue(requests);
+                shutdownThreadPool(pool);
+                exit(errsv);
+            }
+
+            stream_scan.dirname = dirname;
+            stream_scan.stream = stream;
+            stream_scan.n_threads = (scan_threads == 0) ? 1 : scan_threads;
+            stream_scan.progname = argv[0];
+
+            if ((error_number = pthread_create(&stream_scan_tid, NULL, stream_scan_thread, &stream_scan)) != 0) {
+                fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_create() 'stream_scan_thread': %s\n", argv[0], strerror(error_number)); 
+                deleteQueue(requests);
+                deleteStream(stream);
+                shutdownThreadPool(pool);
+                exit(error_number);
+            }
+        }
+
         // Unblock signal SIGHUP, SIGINT, SIGQUIT, SIGTERM
-        // Signal SIGUSR1 remains blocked
+        // Signal SIGUSR1 and SIGUSR2 remain blocked
         sigdelset(&mask, SIGUSR1);
+        sigdelset(&mask, SIGUSR2);
 
         if ((error_number = pthread_sigmask(SIG_UNBLOCK , &mask, NULL)) != 0) {
             fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_sigmask(): %s\n", argv[0], strerror(error_number));
@@ -390,22 +771,95 @@ int main(int argc, char *argv[]) {
         }
 
         // Submit 'filename' to thread pool every 'delay' ms
+        struct timespec poll_time;
+        size_t n_submitted = 0;
         char *filename;
 
         while (!sigexit) {
-            // Pop 'filename' from the queue 
-            if ((errno = 0, filename = popQueue(requests)) != NULL) {
+            // Pop 'filename' from the queue, then from the stream of the scan
+            // The stream is polled every STREAM_POLL ms, so the termination flag is checked during a long scan
+            if (((errno = 0, filename = popQueue(requests, &key)) == NULL) && (errno == 0) && (stream != NULL)) {
+                clock_gettime(CLOCK_MONOTONIC, &poll_time);
+                poll_time.tv_nsec += STREAM_POLL * 1000000;
+                poll_time.tv_sec += poll_time.tv_nsec / 1000000000;
+                poll_time.tv_nsec %= 1000000000;
+
+                if (((filename = timedPopStream(stream, &key, &poll_time)) == NULL) && (errno == ETIMEDOUT)) {
+                    // Send the results found in the cache while the scan is running
+                    SYSCALL_EXIT(argv[0], "flushResults()", flushResults(&hits, master_fd))
+                    continue;
+                }
+            }
+
+            if (filename != NULL) {
+                n_submitted++;
+
+                // Add 'filename' to the table of the paths, the results of the file refer to its ID and its submission number
+                // In watch mode a file keeps its ID, the Collector keeps the result of the last submission of each ID
+                uint64_t id;
+
+                if ((id = internPath(paths, filename, watch != NULL)) == 0) {
+                    errsv = errno;
+                    fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m internPath() '%s': %s\n", argv[0], filename, strerror(errsv)); 
+                    freeFilename(filename);
+                    deleteQueue(requests);
+                    shutdownThreadPool(pool);
+                    exit(errsv);
+                }
+
+                // Send the result of an unchanged 'filename' found in the cache, without reading it
+                // Of a grown 'filename' only the bytes after 'offset' are read
+                CacheEntry_t *entry = NULL;
+                long result = 0;
+                off_t offset = 0;
+
+                if ((cache != NULL) && lookupCache(cache, filename, &key, &result, &offset, &entry)) {
+                    freeFilename(filename);
+
+                    if (sendResult(hit_ring, &hits, master_fd, id, n_submitted, result) == -1) {
+                        errsv = errno;
+                        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m sendResult(): %s\n", argv[0], strerror(errsv)); 
+                        deleteQueue(requests);
+                        shutdownThreadPool(pool);
+                        exit(errsv);
+                    }
+
+                    continue;
+                }
+
                 // Submit 'filename' to thread pool
-                if (submitThreadPool(pool, filename) == -1) {
+                if (submitThreadPool(pool, filename, id, n_submitted, key.size, offset, result, entry) == -1) {
                     errsv = errno;
                     fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m executeThreadPool(): %s\n", argv[0], strerror(errsv)); 
                     deleteQueue(requests);
                     shutdownThreadPool(pool);
                     exit(errsv);
                 }
+            } else if ((errno == 0) && (watch != NULL)) {
+                // Queue is empty and the scan is over, wait for the files written in the 'dirname' directory tree
+                // The watch is polled every STREAM_POLL ms, so the termination flag is checked
+                SYSCALL_EXIT(argv[0], "flushResults()", flushResults(&hits, master_fd))
+
+                if (readWatch(watch, requests, STREAM_POLL) == -1) {
+                    errsv = errno;
+                    fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m readWatch() '%s': %s\n", argv[0], dirname, strerror(errsv)); 
+                    deleteQueue(requests);
+                    shutdownThreadPool(pool);
+                    exit(errsv);
+                }
+
+                continue;
             } else if (errno == 0) {
-                // Queue is empty
+                // Queue is empty and the scan is over
                 break;
+            } else if (stream != NULL) {
+                // The scan failed, the scanner threads have already reported the error
+                errsv = errno;
+                pthread_join(stream_scan_tid, NULL);
+                deleteStream(stream);
+                deleteQueue(requests);
+                shutdownThreadPool(pool);
+                exit(errsv);
             } else {
                 errsv = errno;
                 fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m popQueue(): %s\n", argv[0], strerror(errsv)); 
@@ -416,6 +870,8 @@ int main(int argc, char *argv[]) {
 
             // Suspend execution for 'delay' ms
             if (delay) {
+                SYSCALL_EXIT(argv[0], "flushResults()", flushResults(&hits, master_fd))
+
                 while (nanosleep(&time_request, &time_remaining) != 0) {
                     // Check if it has been interrupted by a signal handler
                     if (errno == EINTR) {
@@ -440,12 +896,41 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        // Delete 'requests' queue
+        // Stop the scan of the streaming dispatch if it is still running
+        int interrupted = sigexit;
+
+        if (stream != NULL) {
+            SYSCALL_EXIT(argv[0], "cancelStream()", cancelStream(stream))
+
+            if ((error_number = pthread_join(stream_scan_tid, NULL)) != 0) {
+                fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_join() 'stream_scan_thread': %s\n", argv[0], strerror(error_number));
+                exit(error_number);
+            }
+
+            deleteStream(stream);
+        }
+
+        // Delete 'requests' queue and the watch of the 'dirname' directory tree
         deleteQueue(requests);
+        deleteWatch(watch);
+
+        // Send the last results found in the cache and close the channel of the Master thread
+        if (master_fd != -1) {
+            SYSCALL_EXIT(argv[0], "flushResults()", flushResults(&hits, master_fd))
+            close(master_fd);
+        }
         
         // Initiate an orderly shutdown of the thread pool in which previously submitted tasks are executed
         SYSCALL_EXIT(argv[0], "shutdownThreadPool()", shutdownThreadPool(pool))
 
+        // Close the cache, the Worker threads have stored the results of the FILEs they read
+        if (cache != NULL) {
+            fprintf(stderr, "%s: cache '%s': %zu hits, %zu grown, %zu misses\n", argv[0], cache_pathname, cache->hits, cache->grown, cache->misses);
+
+            if (closeCache(cache) == -1)
+                fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m closeCache() '%s': %s\n", argv[0], cache_pathname, strerror(errno));
+        }
+
         // Wait termination of signal handler thread
         sigexit = 1;
 
@@ -454,16 +939,15 @@ int main(int argc, char *argv[]) {
             exit(error_number);
         }
 
-        // Destroy and free 'collector_fd_mutex'
-        if ((error_number = pthread_mutex_destroy(collector_fd_mutex)) != 0) {
-            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_mutex_destroy(): %s\n", argv[0], strerror(error_number));
-            exit(error_number);
+        // The streaming scan found no files, the Collector process terminates without any result
+        if ((n_submitted == 0) && !interrupted) {
+            info(argv[0]);
+            exit(EXIT_FAILURE);
         }
 
-        free(collector_fd_mutex);
-
-        // Send 0 (exit) to Collector process
-        int opcode = 0;
+        // Send 0 (exit) to Collector process, the end of the stream of results
+        // The Worker threads have closed their channels or published their results
+        opcode = OPCODE_EXIT;
         
         SYSCALL_EXIT(argv[0], "writen() 'opcode: 0 (exit)'", writen(cfd, &opcode, sizeof(int)))
 
@@ -512,11 +996,29 @@ static void usage() {
     fprintf(stderr, "  \x1B[1m-n\x1B[0m \x1B[4mthreads\x1B[0m\x1B[21Gnumber of Worker threads (default value \x1B[1m4\x1B[0m)\n");
     fprintf(stderr, "  \x1B[1m-q\x1B[0m \x1B[4msize\x1B[0m\x1B[21Glength of the concurrent queue between the Master thread and the Worker threads (default value \x1B[1m8\x1B[0m)\n");
     fprintf(stderr, "  \x1B[1m-d\x1B[0m \x1B[4mdirname\x1B[0m\x1B[21Gcalculate the result for each binary FILE in the \x1B[4mdirname\x1B[0m directory and subdirectories\n");
-    fprintf(stderr, "  \x1B[1m-t\x1B[0m \x1B[4mdelay\x1B[0m\x1B[21Gtime in milliseconds between the sending of two successive requests to\n\x1B[21Gthe Worker threads by the Master thread (default value \x1B[1m0\x1B[0m)\n\n");
+    fprintf(stderr, "  \x1B[1m-t\x1B[0m \x1B[4mdelay\x1B[0m\x1B[21Gtime in milliseconds between the sending of two successive requests to\n\x1B[21Gthe Worker threads by the Master thread (default value \x1B[1m0\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-r\x1B[0m \x1B[4mengine\x1B[0m\x1B[21Gengine used by the Worker threads to read the FILEs: \x1B[1mstdio\x1B[0m, \x1B[1mmmap\x1B[0m, \x1B[1muring\x1B[0m or \x1B[1mauto\x1B[0m (mmap for\n\x1B[21GFILEs of at least 4 MiB, stdio otherwise) (default value \x1B[1mauto\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-u\x1B[0m \x1B[4mdepth\x1B[0m\x1B[21Gnumber of FILEs read at the same time by each Worker thread with the \x1B[1muring\x1B[0m engine\n\x1B[21G(default value \x1B[1m8\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-T\x1B[0m \x1B[4mtransport\x1B[0m\x1B[21Gtransport of the results to the Collector process: \x1B[1mshm\x1B[0m (shared memory ring) or\n\x1B[21G\x1B[1msocket\x1B[0m (a UNIX socket for each Worker thread) (default value \x1B[1mshm\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-s\x1B[0m \x1B[4mscheduler\x1B[0m\x1B[21Gscheduling of the FILEs among the Worker threads: \x1B[1mshared\x1B[0m (a single queue), \x1B[1mrr\x1B[0m or\n\x1B[21G\x1B[1mlocality\x1B[0m (work stealing, FILEs assigned round-robin or by directory) (default value \x1B[1mshared\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-p\x1B[0m \x1B[4mpolicy\x1B[0m\x1B[21Gorder in which the FILEs are sent to the Worker threads: \x1B[1mfifo\x1B[0m (order of the arguments\n\x1B[21Gand of the scan), \x1B[1mlpt\x1B[0m (largest first) or \x1B[1msjf\x1B[0m (smallest first) (default value \x1B[1mfifo\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-x\x1B[0m \x1B[4mcachefile\x1B[0m\x1B[21Gcache of the results in the \x1B[4mcachefile\x1B[0m file, the FILEs with the same device, inode, size and\n\x1B[21Gmodification time of a previous run are not read again\n");
+    fprintf(stderr, "  \x1B[1m-X\x1B[0m\x1B[21Gread all the FILEs again and refresh their results in the \x1B[4mcachefile\x1B[0m file\n");
+    fprintf(stderr, "  \x1B[1m-i\x1B[0m \x1B[4mmode\x1B[0m\x1B[21Grecompute of the FILEs grown since their result was stored in the \x1B[4mcachefile\x1B[0m file: \x1B[1moff\x1B[0m\n\x1B[21G(read again), \x1B[1mappend\x1B[0m (only the appended bytes are read) or \x1B[1mverify\x1B[0m (as append if the first\n\x1B[21G4096 bytes are the same) (default value \x1B[1moff\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-m\x1B[0m \x1B[4mdispatch\x1B[0m\x1B[21Gdispatch of the FILEs of the \x1B[4mdirname\x1B[0m directory to the Worker threads: \x1B[1mbatch\x1B[0m (after the\n\x1B[21Gwhole scan) or \x1B[1mstream\x1B[0m (while the scan is running) (default value \x1B[1mbatch\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-w\x1B[0m\x1B[21Gwatch the \x1B[4mdirname\x1B[0m directory tree after the scan and calculate the result for each FILE written or\n\x1B[21Gmoved in it, the new result of a FILE replaces the previous one (the process terminates on\n\x1B[21GSIGHUP, SIGINT, SIGQUIT or SIGTERM, it cannot be used with \x1B[1m-k\x1B[0m, \x1B[1m-K\x1B[0m or \x1B[1m-M\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-S\x1B[0m \x1B[4mthreads\x1B[0m\x1B[21Gnumber of scanner threads reading the \x1B[4mdirname\x1B[0m directory tree in parallel,\n\x1B[21G\x1B[1m0\x1B[0m reads it sequentially (default value \x1B[1m0\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-k\x1B[0m \x1B[4mN\x1B[0m\x1B[21Gprint only the \x1B[4mN\x1B[0m smallest results, the others are dropped as they arrive\n");
+    fprintf(stderr, "  \x1B[1m-K\x1B[0m \x1B[4mN\x1B[0m\x1B[21Gprint only the \x1B[4mN\x1B[0m largest results, the others are dropped as they arrive\n");
+    fprintf(stderr, "  \x1B[1m-M\x1B[0m \x1B[4mbytes\x1B[0m\x1B[21Gmemory cap of the results in the Collector process, beyond it they are sorted and spilled\n\x1B[21Gto runs in \x1B[1mTMPDIR\x1B[0m (default /tmp) merged at each print, \x1B[1m0\x1B[0m for no cap (default value \x1B[1m0\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-C\x1B[0m \x1B[4mthreads\x1B[0m\x1B[21Gnumber of threads of the Collector process sorting and printing the results in parallel\n\x1B[21G(default value \x1B[1m1\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-o\x1B[0m \x1B[4mformat\x1B[0m\x1B[21Gformat of the results: \x1B[1mtext\x1B[0m (a line for each result) or \x1B[1mbinary\x1B[0m (a block for each print\n\x1B[21Gwith header, records and string table) (default value \x1B[1mtext\x1B[0m)\n");
+    fprintf(stderr, "  \x1B[1m-c\x1B[0m \x1B[4msize\x1B[0m\x1B[21Gsize in bytes of the chunks in which larger FILEs are split among the Worker threads,\n\x1B[21G\x1B[1m0\x1B[0m disables the splitting (default value \x1B[1m67108864\x1B[0m)\n\n");
     fprintf(stderr, "  \x1B[1mSignals:\x1B[0m\n\n");
     fprintf(stderr, "  Signal\x1B[44GAction\n");
     fprintf(stderr, "  ──────────────────────────────────────────────────────────────────────────────────────────────────\n");
     fprintf(stderr, "  \x1B[1mSIGUSR1\x1B[0m\x1B[44Gprint the results calculated up to that moment\n");
+    fprintf(stderr, "  \x1B[1mSIGUSR2\x1B[0m\x1B[44Gprint only the results calculated after the previous print\n");
     fprintf(stderr, "  \x1B[1mSIGHUP - SIGINT - SIGQUIT - SIGTERM\x1B[0m\x1B[44Gcomplete any tasks in the queue and terminate the process\n");
 }
 
@@ -592,6 +1094,7 @@ static void read_dir(char dirname[], Queue_t *requests, char progname[]) {
 
 	struct dirent *entry;
     struct stat statbuf;
+    FileKey_t key;
     char filename[PATHNAME_MAX + 1];
     int len_dirname, len_filename;
     
@@ -633,7 +1136,9 @@ static void read_dir(char dirname[], Queue_t *requests, char progname[]) {
                 fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s': Invalid format\n", progname, filename);
             } else {
                 // Insert 'filename' in the 'requests' queue
-                if (pushQueue(requests, filename) == -1) {
+                keyFile(&key, &statbuf);
+
+                if (pushQueue(requests, filename, &key) == -1) {
                     int errsv = errno;
                     fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pushQueue() '%s': %s\n", progname, filename, strerror(errsv)); 
                     deleteQueue(requests);
@@ -660,6 +1165,21 @@ static void read_dir(char dirname[], Queue_t *requests, char progname[]) {
     }
 }
 
+// Thread running the scan of the streaming dispatch, the files found are appended to the stream until the end of the scan
+static void *stream_scan_thread(void *arg) {
+    StreamScan_t *scan = (StreamScan_t*) arg;
+    int error_number = 0;
+
+    // A scan stopped by the Master thread is not an error
+    if ((scanDirectory(scan->dirname, NULL, scan->stream, scan->n_threads, PATHNAME_MAX, scan->progname) == -1) && (errno != ECANCELED))
+        error_number = errno;
+
+    // End of the stream
+    SYSCALL_EXIT(scan->progname, "closeStream()", closeStream(scan->stream, error_number))
+
+    return NULL;
+}
+
 // Function registered using atexit()
 static void cleanup() {
     unlink(SOCK_PATHNAME);
@@ -679,31 +1199,27 @@ static void sigexit_handler(int signo) {
     }
 }
 
-// Signal handler thread, send print command to Collector process when signal SIGUSR1 is caught
+// Signal handler thread, send print command to Collector process when signal SIGUSR1 or SIGUSR2 is caught
 static void *sigprint_handler_thread(void *arg) {
-    // Check arg
-    if (arg == NULL) {
-        fprintf(stderr, "sigprint_handler_thread: \x1B[1;31merror:\x1B[0m Invalid argument\n");
-        exit(EINVAL);
-    }
+    // No arguments, the thread is the only writer of 'cfd' while it runs
+    (void) arg;
 
-    pthread_mutex_t *collector_fd_mutex = (pthread_mutex_t*) arg;
-
-    // Set signal SIGUSR1 
+    // Set signal SIGUSR1 and SIGUSR2
     sigset_t set;
     sigemptyset(&set);
     sigaddset(&set, SIGUSR1);
+    sigaddset(&set, SIGUSR2);
 
     // Set a timeout of 1 ms
     struct timespec timeout;
     timeout.tv_sec = 0;
     timeout.tv_nsec = 1000000;
 
-    int opcode = -1, tid = 0, error_number;
+    int signo, opcode, tid = 0;
 
     while(!sigexit) {
         // Suspend execution until the signal in set is pending
-        if (sigtimedwait(&set, NULL, &timeout) == -1) {
+        if ((signo = sigtimedwait(&set, NULL, &timeout)) == -1) {
             // Check if timeout has expired or if it has been interrupted by a signal handler
             if ((errno == EAGAIN) || (errno == EINTR)) {
                 continue;
@@ -715,21 +1231,19 @@ static void *sigprint_handler_thread(void *arg) {
                 exit(errsv);
             }
         } else {
-            LOCK_EXIT(collector_fd_mutex, error_number, tid)
+            // Send -1 (print) or -4 (delta print) to Collector process
+            opcode = (signo == SIGUSR2) ? OPCODE_DELTA : OPCODE_PRINT;
 
-            // Send -1 (print) to Collector process
             if (writen(cfd, &opcode, sizeof(int)) == -1) {
                 int errsv = errno;
-                fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m writen() 'opcode: -1 (print)': ", tid); 
+                fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m writen() 'opcode: %d (print)': ", tid, opcode); 
                 errno = errsv;
                 perror(NULL);
                 exit(errsv);
             }
-
-            UNLOCK_EXIT(collector_fd_mutex, error_number, tid)
         }
     }
 
     // Success
     pthread_exit(NULL);
-}
\ No newline at end of file
+}
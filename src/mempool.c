@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <utils.h>
+#include <mempool.h>
+
+/*  Refill the local list of the pool pointed to by p, first with the blocks freed by the other threads and then with a new slab.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+static int refill(MemPool_t *p) {
+    if ((p->local = __atomic_exchange_n(&p->remote, NULL, __ATOMIC_ACQUIRE)) != NULL) return 0;
+
+    size_t stride = sizeof(MemBlock_t) + p->block_size;
+    MemSlab_t *slab;
+
+    // Round the stride to the size of the header, so every block is aligned like a pointer
+    stride = (stride + sizeof(MemBlock_t) - 1) / sizeof(MemBlock_t) * sizeof(MemBlock_t);
+
+    if ((slab = malloc(sizeof(MemSlab_t) + MEMPOOL_SLAB * stride)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
+        errno = errsv;
+        return -1;
+    }
+
+    slab->next = p->slabs;
+    p->slabs = slab;
+
+    // Chain the blocks of the slab in the local list
+    char *blocks = (char*) (slab + 1);
+
+    for (size_t i = 0; i < MEMPOOL_SLAB; i++)
+        ((MemBlock_t*) (blocks + i * stride))->next = (i == MEMPOOL_SLAB - 1) ? NULL : (MemBlock_t*) (blocks + (i + 1) * stride);
+
+    p->local = (MemBlock_t*) blocks;
+
+    return 0;
+}
+
+/*  Allocate 'size' bytes from the pool pointed to by p, with malloc() if they do not fit in a block.
+ *
+ *  RETURN VALUE: pointer to the memory on success
+ *                NULL on error (errno is set)
+ */
+void *allocMemPool(MemPool_t *p, size_t size) {
+    // Check pool pointer
+    if (p == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    MemBlock_t *b;
+
+    if (size > p->block_size) {
+        // Oversized block, it is given back to free()
+        if ((b = malloc(sizeof(MemBlock_t) + size)) == NULL) {
+            int errsv = errno;
+            fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
+            errno = errsv;
+            return NULL;
+        }
+
+        b->pool = NULL;
+        return b + 1;
+    }
+
+    int error_number;
+
+    LOCK_RETURN(&p->mutex, error_number, NULL)
+
+    if ((p->local == NULL) && (refill(p) == -1)) {
+        int errsv = errno;
+        pthread_mutex_unlock(&p->mutex);
+        errno = errsv;
+        return NULL;
+    }
+
+    b = p->local;
+    p->local = b->next;
+
+    UNLOCK_RETURN(&p->mutex, error_number, NULL)
+
+    b->pool = p;
+    return b + 1;
+}
+
+// Free memory allocated with allocMemPool() pointed to by ptr, from any thread
+void freeMemPool(void *ptr) {
+    if (ptr != NULL) {
+        MemBlock_t *b = (MemBlock_t*) ptr - 1;
+        MemPool_t *p = b->pool;
+
+        if (p == NULL) {
+            free(b);
+            return;
+        }
+
+        // Push the block on the remote list, the allocator only takes the whole list so there is no ABA problem
+        b->next = __atomic_load_n(&p->remote, __ATOMIC_RELAXED);
+
+        while (!__atomic_compare_exchange_n(&p->remote, &b->next, b, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+}
@@ -0,0 +1,284 @@
+#define _GNU_SOURCE // memfd_create()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pathtable.h>
+
+// The nodes are aligned like PathNode_t, the first one follows the counter of used bytes
+#define NODE_ALIGN sizeof(uint64_t)
+
+// Pointer to the node of offset 'id' in the region of t
+#define NODE(t, id) ((PathNode_t*) ((t)->map + (id)))
+
+/*  Initialize a table of paths in a shared memory region of at most 'size' bytes, inherited by fork().
+ *  The region grows by PATHTABLE_GROW bytes at a time, the address space reserved is halved until the system grants it.
+ *
+ *  RETURN VALUE: pointer to the new table on success
+ *                NULL on error (errno is set)
+ */
+PathTable_t *initPathTable(size_t size) {
+    // Check size
+    if (size < NODE_ALIGN + sizeof(PathNode_t)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Allocate table data structure
+    PathTable_t *t;
+
+    if ((t = malloc(sizeof(PathTable_t))) == NULL)
+        return NULL;
+
+    // Create the shared memory region, its pages are allocated when they are written
+    t->file_size = (size < PATHTABLE_GROW) ? size : PATHTABLE_GROW;
+
+    if ((t->fd = memfd_create("farm-paths", MFD_CLOEXEC)) == -1) {
+        int errsv = errno;
+        free(t);
+        errno = errsv;
+        return NULL;
+    }
+
+    if (ftruncate(t->fd, t->file_size) == -1) {
+        int errsv = errno;
+        close(t->fd);
+        free(t);
+        errno = errsv;
+        return NULL;
+    }
+
+    // Reserve the address space of the whole region at once, the pages beyond the file are never accessed
+    while (((t->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, t->fd, 0)) == MAP_FAILED) &&
+           (errno == ENOMEM) && (size / 2 >= t->file_size))
+        size /= 2;
+
+    if (t->map == MAP_FAILED) {
+        int errsv = errno;
+        close(t->fd);
+        free(t);
+        errno = errsv;
+        return NULL;
+    }
+
+    // Init variables, the hash tables and the cache are allocated by the writer
+    t->map_size = size;
+    t->used = (size_t*) t->map;
+    *t->used = NODE_ALIGN;
+    t->dirs = NULL;
+    t->dirs_size = 0;
+    t->n_dirs = 0;
+    t->files = NULL;
+    t->files_size = 0;
+    t->n_files = 0;
+    t->last_dir = NULL;
+    t->last_len = 0;
+    t->last_size = 0;
+    t->last_node = 0;
+
+    // Return pointer to the table
+    return t;
+}
+
+// Delete a table allocated with initPathTable() pointed to by t, in the calling process
+void deletePathTable(PathTable_t *t) {
+    if (t != NULL) {
+        munmap(t->map, t->map_size);
+        close(t->fd);
+        free(t->dirs);
+        free(t->files);
+        free(t->last_dir);
+        free(t);
+    }
+}
+
+// Hash (FNV-1a) of the component 'name' of length 'len' in the directory of offset 'parent'
+static size_t hash_node(uint64_t parent, const char name[], size_t len) {
+    uint64_t hash = 14695981039346656037ULL ^ parent;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash ^ (hash >> 32);
+}
+
+/*  Append the node of 'name' of length 'len' in the directory of offset 'parent' to the region of t, and publish it.
+ *  The file of the region grows by PATHTABLE_GROW bytes when the node does not fit.
+ *
+ *  RETURN VALUE: offset of the new node on success
+ *                0 on error (errno is set, ENOSPC if the reservation is full)
+ */
+static uint64_t append_node(PathTable_t *t, uint64_t parent, const char name[], size_t len) {
+    size_t used = *t->used, size = (sizeof(PathNode_t) + len + NODE_ALIGN - 1) / NODE_ALIGN * NODE_ALIGN;
+
+    if ((len > UINT32_MAX) || (size > t->map_size - used)) {
+        errno = ENOSPC;
+        return 0;
+    }
+
+    if (used + size > t->file_size) {
+        size_t new_size = (used + size + PATHTABLE_GROW - 1) / PATHTABLE_GROW * PATHTABLE_GROW;
+
+        if (new_size > t->map_size) new_size = t->map_size;
+
+        if (ftruncate(t->fd, new_size) == -1)
+            return 0;
+
+        t->file_size = new_size;
+    }
+
+    PathNode_t *node = NODE(t, used);
+
+    node->parent = parent;
+    node->len = len;
+    node->path_len = (parent == 0) ? len : NODE(t, parent)->path_len + 1 + len;
+    memcpy(node->name, name, len);
+
+    // The reader sees the node once it sees the new size
+    __atomic_store_n(t->used, used + size, __ATOMIC_RELEASE);
+
+    return used;
+}
+
+/*  Return the node of 'name' of length 'len' in the directory of offset 'parent', adding it the first time.
+ *  The nodes are looked up in the hash table '*table' of '*size' slots holding '*count' nodes.
+ *
+ *  RETURN VALUE: offset of the node on success
+ *                0 on error (errno is set)
+ */
+static uint64_t intern_node(PathTable_t *t, uint64_t **table, size_t *size, size_t *count, uint64_t parent, const char name[], size_t len) {
+    // Double the hash table when it is half full
+    if (2 * (*count + 1) > *size) {
+        size_t new_size = (*size == 0) ? PATHTABLE_SLOTS : 2 * *size;
+        uint64_t *new_table;
+
+        if ((new_table = calloc(new_size, sizeof(uint64_t))) == NULL)
+            return 0;
+
+        for (size_t i = 0; i < *size; i++) {
+            if ((*table)[i] != 0) {
+                PathNode_t *node = NODE(t, (*table)[i]);
+                size_t j = hash_node(node->parent, node->name, node->len) & (new_size - 1);
+
+                while (new_table[j] != 0) j = (j + 1) & (new_size - 1);
+
+                new_table[j] = (*table)[i];
+            }
+        }
+
+        free(*table);
+        *table = new_table;
+        *size = new_size;
+    }
+
+    // Linear probing until the node or an empty slot
+    uint64_t *slots = *table;
+    size_t i = hash_node(parent, name, len) & (*size - 1);
+
+    for (; slots[i] != 0; i = (i + 1) & (*size - 1)) {
+        PathNode_t *node = NODE(t, slots[i]);
+
+        if ((node->parent == parent) && (node->len == len) && (memcmp(node->name, name, len) == 0))
+            return slots[i];
+    }
+
+    if ((slots[i] = append_node(t, parent, name, len)) != 0) (*count)++;
+
+    return slots[i];
+}
+
+/*  Add 'path' to the table pointed to by t, its directories are added only the first time. If 'reuse' is not zero the path
+ *  is added only the first time too and keeps its ID, otherwise each call adds a new node. Only one thread may add paths.
+ *
+ *  RETURN VALUE: ID of the path on success
+ *                0 on error (errno is set, ENOSPC if the reservation is full)
+ */
+uint64_t internPath(PathTable_t *t, const char path[], int reuse) {
+    // Check arguments
+    if ((t == NULL) || (path == NULL)) {
+        errno = EINVAL;
+        return 0;
+    }
+
+    const char *slash = strrchr(path, '/');
+    uint64_t parent = 0;
+
+    if (slash != NULL) {
+        size_t dir_len = slash - path;
+
+        // The files of a directory usually come one after the other, the last directory is looked up first
+        if ((t->last_node != 0) && (dir_len == t->last_len) && (memcmp(path, t->last_dir, dir_len) == 0)) {
+            parent = t->last_node;
+        } else {
+            // Add the components of the directory one by one
+            for (const char *name = path, *end; name <= slash; name = end + 1) {
+                end = memchr(name, '/', slash - name + 1);
+
+                if ((parent = intern_node(t, &t->dirs, &t->dirs_size, &t->n_dirs, parent, name, end - name)) == 0)
+                    return 0;
+            }
+
+            // Remember the directory
+            if (dir_len + 1 > t->last_size) {
+                char *new_dir;
+
+                if ((new_dir = realloc(t->last_dir, dir_len + 1)) == NULL)
+                    return 0;
+
+                t->last_dir = new_dir;
+                t->last_size = dir_len + 1;
+            }
+
+            memcpy(t->last_dir, path, dir_len);
+            t->last_len = dir_len;
+            t->last_node = parent;
+        }
+
+        path = slash + 1;
+    }
+
+    if (reuse) return intern_node(t, &t->files, &t->files_size, &t->n_files, parent, path, strlen(path));
+
+    return append_node(t, parent, path, strlen(path));
+}
+
+// Check if 'id' is the ID of a path published in the table pointed to by t
+int checkPath(const PathTable_t *t, uint64_t id) {
+    size_t used = __atomic_load_n(t->used, __ATOMIC_ACQUIRE);
+
+    return (id >= NODE_ALIGN) && (id % NODE_ALIGN == 0) && (id + sizeof(PathNode_t) <= used) &&
+           (NODE(t, id)->len <= used - id - sizeof(PathNode_t));
+}
+
+// Return the length of the path of ID 'id' in the table pointed to by t
+size_t lengthPath(const PathTable_t *t, uint64_t id) {
+    return NODE(t, id)->path_len;
+}
+
+// Return the number of bytes of the region of the table pointed to by t published so far
+size_t usedPathTable(const PathTable_t *t) {
+    return __atomic_load_n(t->used, __ATOMIC_ACQUIRE);
+}
+
+// Write the path of ID 'id' in the table pointed to by t to 'buf', without '\0', buf must have lengthPath() bytes
+void copyPath(const PathTable_t *t, uint64_t id, char buf[]) {
+    PathNode_t *node = NODE(t, id);
+    size_t pos = node->path_len;
+
+    // From the last component back to the first one
+    while (1) {
+        pos -= node->len;
+        memcpy(buf + pos, node->name, node->len);
+
+        if (node->parent == 0) break;
+
+        buf[--pos] = '/';
+        node = NODE(t, node->parent);
+    }
+}
@@ -2,14 +2,111 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <mempool.h>
 #include <queue.h>
 
-/*  Initialize an unbounded queue. 
+// Recycled buffers of the popped filenames, freed by the Workers and reused by the Master
+static MemPool_t filename_pool = MEMPOOL_INITIALIZER(QUEUE_FILENAME);
+
+// Bytes taken in a chunk by the node of a filename of 'len' characters, nodes are aligned like Node_t
+static size_t node_size(size_t len) {
+    size_t size = sizeof(Node_t) + len + 1;
+
+    return (size + sizeof(off_t) - 1) / sizeof(off_t) * sizeof(off_t);
+}
+
+// Keep the drained chunk pointed to by c as the spare chunk of q, or free it if q already has one
+static void release_chunk(Queue_t *q, Chunk_t *c) {
+    if (q->spare == NULL)
+        q->spare = c;
+    else
+        free(c);
+}
+
+// Check if the entry a of the heap of q is pulled before the entry b
+static int before(const Queue_t *q, const HeapEntry_t *a, const HeapEntry_t *b) {
+    if (a->node->key.size != b->node->key.size)
+        return (q->order == QUEUE_LARGEST) ? (a->node->key.size > b->node->key.size) : (a->node->key.size < b->node->key.size);
+
+    return a->seq < b->seq;
+}
+
+/*  Grow the heap of q to hold at least 'n' entries.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+static int reserve_heap(Queue_t *q, size_t n) {
+    if (n <= q->heap_size) return 0;
+
+    size_t new_size = (q->heap_size == 0) ? QUEUE_HEAP : q->heap_size;
+    HeapEntry_t *new_heap;
+
+    while (new_size < n) new_size *= 2;
+
+    if ((new_heap = realloc(q->heap, new_size * sizeof(HeapEntry_t))) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m realloc()\n");
+        errno = errsv;
+        return -1;
+    }
+
+    q->heap = new_heap;
+    q->heap_size = new_size;
+
+    return 0;
+}
+
+// Insert the node pointed to by n in the heap of q, it must have room for it
+static void insert_heap(Queue_t *q, Node_t *n) {
+    HeapEntry_t e = {n, q->seq++};
+    size_t i = q->qlen;
+
+    // Sift up
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+
+        if (!before(q, &e, &q->heap[parent])) break;
+
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+
+    q->heap[i] = e;
+    q->qlen++;
+}
+
+// Remove the first entry of the non empty heap of q
+static void remove_heap(Queue_t *q) {
+    HeapEntry_t e = q->heap[--q->qlen];
+    size_t i = 0, child;
+
+    // Sift down the last entry from the root
+    while ((child = 2 * i + 1) < q->qlen) {
+        if ((child + 1 < q->qlen) && before(q, &q->heap[child + 1], &q->heap[child])) child++;
+
+        if (!before(q, &q->heap[child], &e)) break;
+
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+
+    q->heap[i] = e;
+}
+
+/*  Initialize an unbounded queue, the filenames are pulled in the order 'order'.
  *
  *  RETURN VALUE: pointer to the new queue on success
  *                NULL on error (errno is set)
  */
-Queue_t *initQueue() {
+Queue_t *initQueue(QueueOrder_t order) {
+    // Check order
+    if ((order != QUEUE_FIFO) && (order != QUEUE_LARGEST) && (order != QUEUE_SMALLEST)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+
     // Allocate queue data structure
     Queue_t *q;
 
@@ -23,7 +120,12 @@ Queue_t *initQueue() {
     // Init variables
     q->head = NULL;
     q->tail = NULL;    
+    q->spare = NULL;
     q->qlen = 0;
+    q->order = order;
+    q->heap = NULL;
+    q->heap_size = 0;
+    q->seq = 0;
     
     // Return pointer to the queue
     return q;
@@ -32,82 +134,100 @@ Queue_t *initQueue() {
 // Delete a queue allocated with initQueue() pointed to by q
 void deleteQueue(Queue_t *q) {
     if (q != NULL) {
-        // Free all filenames if present
-        if (q->qlen != 0) {
-            Node_t *n;
-
-            while(q->head != NULL) {
-                n = q->head;
-                q->head = q->head->next;
-                free(n->filename);
-                free(n);
-            }
+        // Free all chunks, the filenames are inside them
+        Chunk_t *c;
+
+        while (q->head != NULL) {
+            c = q->head;
+            q->head = q->head->next;
+            free(c);
         }
+
+        free(q->spare);
+        free(q->heap);
         
         // Free queue
         free(q);
     }
 }
 
-/*  Insert filename into the queue pointed to by q.
+/*  Insert filename of version 'key' into the queue pointed to by q.
  * 
  *  RETURN VALUE: 0 on success
  *                -1 on error (errno is set)
  */
-int pushQueue(Queue_t *q, char filename[]) {
+int pushQueue(Queue_t *q, char filename[], const FileKey_t *key) {
     // Check arguments
-    if ((q == NULL) || (filename == NULL)) {
+    if ((q == NULL) || (filename == NULL) || (key == NULL)) {
         errno = EINVAL;
         return -1;
     }
 
-    // Allocate new node
-    Node_t *n;
+    size_t filename_len = strlen(filename);
+    size_t n_size = node_size(filename_len);
+    Chunk_t *c = q->tail;
 
-    if ((n = malloc(sizeof(Node_t))) == NULL) {
-        int errsv = errno;
-        fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
-        errno = errsv;
-        return -1;
-    }
+    // Make room in the heap first, so an error leaves the queue unchanged
+    if ((q->order != QUEUE_FIFO) && (reserve_heap(q, q->qlen + 1) == -1)) return -1;
 
-    n->next = NULL;
+    // Start a new chunk if the node does not fit in the last one
+    if ((c == NULL) || (c->capacity - c->end < n_size)) {
+        if ((q->spare != NULL) && (q->spare->capacity >= n_size)) {
+            c = q->spare;
+            q->spare = NULL;
+        } else {
+            size_t capacity = (n_size > QUEUE_CHUNK) ? n_size : QUEUE_CHUNK;
 
-    // Insert filename in the node
-    size_t filename_len = strlen(filename);
- 
-    if ((n->filename = malloc(filename_len + 1)) == NULL) {
-        int errsv = errno;
-        fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
-        errno = errsv;
-        return -1;
-    }
+            if ((c = malloc(sizeof(Chunk_t) + capacity)) == NULL) {
+                int errsv = errno;
+                fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
+                errno = errsv;
+                return -1;
+            }
 
-    memcpy(n->filename, filename, filename_len);
-    n->filename[filename_len] = '\0';
+            c->capacity = capacity;
+        }
 
-    if (q->tail == NULL) {
-        q->head = n;
-        q->tail = n;
-    } else {
-        q->tail->next = n;
-        q->tail = n;
+        c->next = NULL;
+        c->begin = 0;
+        c->end = 0;
+
+        if (q->tail == NULL) {
+            q->head = c;
+            q->tail = c;
+        } else {
+            q->tail->next = c;
+            q->tail = c;
+        }
     }
 
-    q->qlen++;
+    // Insert filename in the node
+    Node_t *n = (Node_t*) (c->data + c->end);
+
+    n->key = *key;
+    n->len = filename_len;
+    memcpy(n->filename, filename, filename_len + 1);
+
+    c->end += n_size;
+
+    if (q->order == QUEUE_FIFO)
+        q->qlen++;
+    else
+        insert_heap(q, n);
 
     // Success
     return 0;
 }
 
-/* Pull filename from the queue.
+/* Pull filename from the queue, its version is stored in 'key'.
+ *  The filename is in a buffer recycled across threads, the caller frees it with freeFilename().
  *
  *  RETURN VALUE: pointer to the filename on success
  *                NULL on empty queue or on error (errno is set)
  */
-char *popQueue(Queue_t *q) {
-    // Check queue pointer        
-    if (q == NULL) {
+char *popQueue(Queue_t *q, FileKey_t *key) {
+    // Check arguments        
+    if ((q == NULL) || (key == NULL)) {
         errno = EINVAL;
         return NULL;
     }
@@ -115,18 +235,124 @@ char *popQueue(Queue_t *q) {
     // Check if queue is empty
     if (q->qlen == 0) {
         return NULL;
+    } else if (q->order != QUEUE_FIFO) {
+        // Copy filename out of the first node of the heap
+        Node_t *n = q->heap[0].node;
+        char *filename;
+
+        if ((filename = allocMemPool(&filename_pool, n->len + 1)) == NULL) return NULL;
+
+        memcpy(filename, n->filename, n->len + 1);
+        *key = n->key;
+
+        remove_heap(q);
+
+        // The nodes are removed in any order, the chunks are dropped once the queue is empty and the last one is reused
+        if (q->qlen == 0) {
+            while (q->head != q->tail) {
+                Chunk_t *c = q->head;
+                q->head = c->next;
+                release_chunk(q, c);
+            }
+
+            q->tail->begin = 0;
+            q->tail->end = 0;
+        }
+
+        return filename;
     } else {
-        // Remove filename from the queue
-        Node_t *n = q->head;
-        char *filename = n->filename;
-        if ((q->head = q->head->next) == NULL) q->tail = NULL;
+        // Copy filename out of the first node
+        Chunk_t *c = q->head;
+        Node_t *n = (Node_t*) (c->data + c->begin);
+        char *filename;
+
+        if ((filename = allocMemPool(&filename_pool, n->len + 1)) == NULL) return NULL;
+
+        memcpy(filename, n->filename, n->len + 1);
+        *key = n->key;
+
+        // Remove the node, the last chunk is reused once drained
+        c->begin += node_size(n->len);
         q->qlen--;
-        free(n);
+
+        if (c->begin == c->end) {
+            if (c == q->tail) {
+                c->begin = 0;
+                c->end = 0;
+            } else {
+                q->head = c->next;
+                release_chunk(q, c);
+            }
+        }
 
         return filename;
     }
 } 
 
+/*  Move all the filenames of the queue pointed to by other at the end of the queue pointed to by q,
+ *  in O(1) if q is a FIFO queue, otherwise each filename is inserted in the heap of q.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set), the queues are not changed
+ */
+int appendQueue(Queue_t *q, Queue_t *other) {
+    // Check arguments
+    if ((q == NULL) || (other == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // The nodes of a priority queue are not in the order of its chunks
+    if ((q->order == QUEUE_FIFO) && (other->order != QUEUE_FIFO)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (other->qlen == 0) return 0;
+
+    size_t qlen = q->qlen;
+
+    if (q->order != QUEUE_FIFO) {
+        if (reserve_heap(q, q->qlen + other->qlen) == -1) return -1;
+
+        // Insert the nodes of other in the heap, they stay in the chunks of other moved below
+        if (other->order != QUEUE_FIFO) {
+            for (size_t i = 0; i < other->qlen; i++)
+                insert_heap(q, other->heap[i].node);
+        } else {
+            for (Chunk_t *c = other->head; c != NULL; c = c->next) {
+                for (size_t off = c->begin; off < c->end; off += node_size(((Node_t*) (c->data + off))->len))
+                    insert_heap(q, (Node_t*) (c->data + off));
+            }
+        }
+    } else {
+        q->qlen += other->qlen;
+    }
+
+    if (q->tail == NULL) {
+        q->head = other->head;
+    } else if (qlen == 0) {
+        // Drop the drained chunk, the head of the queue must hold a node
+        release_chunk(q, q->head);
+        q->head = other->head;
+    } else {
+        q->tail->next = other->head;
+    }
+
+    q->tail = other->tail;
+
+    other->head = NULL;
+    other->tail = NULL;
+    other->qlen = 0;
+
+    return 0;
+}
+
+// Free a filename returned by popQueue(), from any thread
+void freeFilename(char filename[]) {
+    freeMemPool(filename);
+}
+
 // Return the current length of the queue passed as an argument
 size_t lengthQueue(Queue_t *q) {
     // Check queue pointer
@@ -0,0 +1,367 @@
+#define _GNU_SOURCE // syscall(), O_DIRECTORY, O_CLOEXEC
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <utils.h>
+#include <stream.h>
+#include <scanner.h>
+
+// Size of the buffer filled by each getdents64() call, a single call reads thousands of entries
+#define SCAN_BUF_SIZE (256 * 1024)
+
+// Maximum number of open directory descriptors held by the directories still to be read,
+// beyond this limit a directory is reopened by pathname when a scanner thread takes it
+#define SCAN_FDS_MAX 256
+
+// Directory entry returned by getdents64(), not exported by glibc
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Directory still to be read
+typedef struct DirJob {
+    int fd;                 // Open descriptor of the directory, -1 if it must be opened by pathname
+    char *path;             // Pathname of the directory
+    size_t len;             // Length of the pathname
+    struct DirJob *next;
+} DirJob_t;
+
+// State shared by the scanner threads
+typedef struct Scanner {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    DirJob_t *jobs;         // Stack of directories still to be read
+    size_t pending;         // Directories in the stack or being read, the scan ends when it reaches 0
+    size_t open_fds;        // Open descriptors held by the directories in the stack
+    int error_number;       // First error of a scanner thread, 0 if none
+    FileStream_t *stream;   // Stream receiving the files after each directory, NULL to collect them until the end
+    size_t pathname_max;
+    const char *progname;
+} Scanner_t;
+
+// Arguments of a scanner thread
+typedef struct ScannerArgs {
+    Scanner_t *scanner;
+    Queue_t *found;         // Valid files found by the thread
+} ScannerArgs_t;
+
+/*  Add the directory 'path' of length 'len' to the stack, opened relative to 'dirfd' as 'name' if the limit of descriptors allows it.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+static int push_job(Scanner_t *s, int dirfd, const char name[], const char path[], size_t len) {
+    DirJob_t *job;
+
+    if ((job = malloc(sizeof(DirJob_t))) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m malloc()\n", s->progname);
+        errno = errsv;
+        return -1;
+    }
+
+    if ((job->path = malloc(len + 1)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m malloc()\n", s->progname);
+        free(job);
+        errno = errsv;
+        return -1;
+    }
+
+    memcpy(job->path, path, len + 1);
+    job->len = len;
+    job->fd = -1;
+
+    int error_number, reserved = 0;
+
+    // Reserve a descriptor
+    LOCK_RETURN(&s->mutex, error_number, -1)
+
+    if (s->open_fds < SCAN_FDS_MAX) {
+        s->open_fds++;
+        reserved = 1;
+    }
+
+    UNLOCK_RETURN(&s->mutex, error_number, -1)
+
+    // Open the directory relative to its parent, on failure it is opened by pathname later and the error is reported there
+    if (reserved && (dirfd != -1))
+        job->fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    LOCK_RETURN(&s->mutex, error_number, -1)
+
+    if (reserved && (job->fd == -1)) s->open_fds--;
+
+    job->next = s->jobs;
+    s->jobs = job;
+    s->pending++;
+
+    SIGNAL_RETURN(&s->cond, error_number, -1)
+    UNLOCK_RETURN(&s->mutex, error_number, -1)
+
+    // Success
+    return 0;
+}
+
+// Delete the directory 'job' taken from the stack
+static void delete_job(DirJob_t *job) {
+    if (job->fd != -1) close(job->fd);
+    free(job->path);
+    free(job);
+}
+
+/*  Read the directory 'job', put the valid files in the 'found' queue and the subdirectories in the stack.
+ *  'buf' is a buffer of SCAN_BUF_SIZE bytes.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+static int scan_job(Scanner_t *s, DirJob_t *job, Queue_t *found, char *buf) {
+    // Open the directory if it has no descriptor
+    if ((job->fd == -1) && ((job->fd = open(job->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)) {
+        int errsv = errno;
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m opendir() '%s': %s\n", s->progname, job->path, strerror(errsv));
+        errno = errsv;
+        return -1;
+    }
+
+    struct linux_dirent64 *entry;
+    struct stat statbuf;
+    FileKey_t key;
+    char filename[s->pathname_max + 1];
+    size_t len_filename;
+    long nread;
+
+    // Read the entries in bulk
+    while ((nread = syscall(SYS_getdents64, job->fd, buf, SCAN_BUF_SIZE)) > 0) {
+        for (long offset = 0; offset < nread; offset += entry->d_reclen) {
+            entry = (struct linux_dirent64*) (buf + offset);
+
+            if ((strcmp(".", entry->d_name) == 0) || (strcmp("..", entry->d_name) == 0))
+                continue;
+
+            // Resolve relative path
+            len_filename = strlen(entry->d_name);
+
+            if ((job->len + len_filename + 1) > s->pathname_max) {
+                fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s/%s': File name too long (PATHNAME_MAX = %zu)\n", s->progname, job->path, entry->d_name, s->pathname_max);
+                continue;
+            }
+
+            memcpy(filename, job->path, job->len);
+            filename[job->len] = '/';
+            memcpy(filename + job->len + 1, entry->d_name, len_filename + 1);
+
+            // A directory needs no stat(), for the other types the size is needed to check the format
+            if (entry->d_type == DT_DIR) {
+                if (push_job(s, job->fd, entry->d_name, filename, job->len + 1 + len_filename) == -1) return -1;
+                continue;
+            } else if ((entry->d_type != DT_REG) && (entry->d_type != DT_LNK) && (entry->d_type != DT_UNKNOWN)) {
+                fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s': Not a regular file\n", s->progname, filename);
+                continue;
+            }
+
+            // Get information about 'filename', relative to the directory
+            if (fstatat(job->fd, entry->d_name, &statbuf, 0) == -1) {
+                int errsv = errno;
+                fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m stat() '%s': %s\n", s->progname, filename, strerror(errsv));
+                errno = errsv;
+                return -1;
+            }
+
+            // Skip the file if it is not regular or if the format is invalid
+            if (S_ISDIR(statbuf.st_mode)) {
+                if (push_job(s, job->fd, entry->d_name, filename, job->len + 1 + len_filename) == -1) return -1;
+            } else if (!S_ISREG(statbuf.st_mode)) {
+                fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s': Not a regular file\n", s->progname, filename);
+            } else if ((statbuf.st_size % sizeof(long)) != 0) {
+                fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s': Invalid format\n", s->progname, filename);
+            } else {
+                keyFile(&key, &statbuf);
+
+                if (pushQueue(found, filename, &key) == -1) {
+                    int errsv = errno;
+                    fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pushQueue() '%s': %s\n", s->progname, filename, strerror(errsv));
+                    errno = errsv;
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Check if an error occurs in getdents64()
+    if (nread == -1) {
+        int errsv = errno;
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m readdir() '%s': %s\n", s->progname, job->path, strerror(errsv));
+        errno = errsv;
+        return -1;
+    }
+
+    // Success
+    return 0;
+}
+
+// Function executed by the scanner threads, take directories from the stack until the scan ends or fails
+static void *scanner_thread(void *arg) {
+    Scanner_t *s = ((ScannerArgs_t*) arg)->scanner;
+    Queue_t *found = ((ScannerArgs_t*) arg)->found;
+    DirJob_t *job;
+    int error_number;
+    char *buf;
+
+    if ((buf = malloc(SCAN_BUF_SIZE)) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m malloc()\n", s->progname);
+        LOCK_RETURN(&s->mutex, error_number, NULL)
+        if (s->error_number == 0) s->error_number = errsv;
+        pthread_cond_broadcast(&s->cond);
+        UNLOCK_RETURN(&s->mutex, error_number, NULL)
+        return NULL;
+    }
+
+    while (1) {
+        // Wait for a directory
+        LOCK_RETURN(&s->mutex, error_number, NULL)
+
+        while ((s->jobs == NULL) && (s->pending != 0) && (s->error_number == 0))
+            WAIT_RETURN(&s->cond, &s->mutex, error_number, NULL)
+
+        // Scan completed or failed
+        if ((s->jobs == NULL) || (s->error_number != 0)) {
+            UNLOCK_RETURN(&s->mutex, error_number, NULL)
+            break;
+        }
+
+        job = s->jobs;
+        s->jobs = job->next;
+        if (job->fd != -1) s->open_fds--;
+
+        UNLOCK_RETURN(&s->mutex, error_number, NULL)
+
+        int errsv = (scan_job(s, job, found, buf) == -1) ? errno : 0;
+
+        delete_job(job);
+
+        // Hand the files of the directory to the consumer of the stream
+        if ((errsv == 0) && (s->stream != NULL) && (lengthQueue(found) != 0) && (appendStream(s->stream, found) == -1))
+            errsv = errno;
+
+        // Directory done, wake up everyone at the end of the scan or on error
+        LOCK_RETURN(&s->mutex, error_number, NULL)
+
+        if ((errsv != 0) && (s->error_number == 0)) s->error_number = errsv;
+        if ((--s->pending == 0) || (s->error_number != 0)) pthread_cond_broadcast(&s->cond);
+
+        UNLOCK_RETURN(&s->mutex, error_number, NULL)
+    }
+
+    free(buf);
+    return NULL;
+}
+
+/*  Search recursively inside 'dirname' directory, valid files, and put them in the 'requests' queue,
+ *  using 'n_threads' scanner threads that share the directories still to be read.
+ *  If 'stream' is not NULL the files are appended to it after each directory instead, while the scan is running.
+ *  Pathnames longer than 'pathname_max' are ignored, warnings and errors are reported with 'progname'.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set, ECANCELED if the consumer has cancelled 'stream')
+ */
+int scanDirectory(const char dirname[], Queue_t *requests, FileStream_t *stream, size_t n_threads, size_t pathname_max, const char progname[]) {
+    // Check arguments
+    if ((dirname == NULL) || ((requests == NULL) && (stream == NULL)) || (n_threads == 0) || (progname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    Scanner_t s;
+    int error_number;
+
+    if ((error_number = pthread_mutex_init(&s.mutex, NULL)) != 0) {
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_mutex_init()\n", progname);
+        errno = error_number;
+        return -1;
+    }
+
+    if ((error_number = pthread_cond_init(&s.cond, NULL)) != 0) {
+        fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_cond_init()\n", progname);
+        pthread_mutex_destroy(&s.mutex);
+        errno = error_number;
+        return -1;
+    }
+
+    s.jobs = NULL;
+    s.pending = 0;
+    s.open_fds = 0;
+    s.error_number = 0;
+    s.pathname_max = pathname_max;
+    s.progname = progname;
+    s.stream = stream;
+
+    pthread_t tids[n_threads];
+    ScannerArgs_t args[n_threads];
+    size_t n_started = 0;
+
+    // The root directory is opened by pathname
+    if (push_job(&s, -1, NULL, dirname, strlen(dirname)) == -1) s.error_number = errno;
+
+    // Spawn the scanner threads, each one collects the files it finds in its own queue
+    for (; (s.error_number == 0) && (n_started < n_threads); n_started++) {
+        args[n_started].scanner = &s;
+
+        if ((args[n_started].found = initQueue(QUEUE_FIFO)) == NULL) {
+            s.error_number = errno;
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m initQueue(): %s\n", progname, strerror(s.error_number));
+            break;
+        }
+
+        if ((error_number = pthread_create(&tids[n_started], NULL, scanner_thread, &args[n_started])) != 0) {
+            fprintf(stderr, "%s: \x1B[1;31merror:\x1B[0m pthread_create() 'scanner_thread': %s\n", progname, strerror(error_number));
+            deleteQueue(args[n_started].found);
+
+            // Stop the threads already started
+            pthread_mutex_lock(&s.mutex);
+            s.error_number = error_number;
+            pthread_cond_broadcast(&s.cond);
+            pthread_mutex_unlock(&s.mutex);
+            break;
+        }
+    }
+
+    // Wait for the scanner threads and merge the files they found
+    for (size_t i = 0; i < n_started; i++) {
+        pthread_join(tids[i], NULL);
+        if ((stream == NULL) && (appendQueue(requests, args[i].found) == -1) && (s.error_number == 0)) s.error_number = errno;
+        deleteQueue(args[i].found);
+    }
+
+    // Delete the directories left by a failed scan
+    for (DirJob_t *job = s.jobs, *next; job != NULL; job = next) {
+        next = job->next;
+        delete_job(job);
+    }
+
+    pthread_cond_destroy(&s.cond);
+    pthread_mutex_destroy(&s.mutex);
+
+    if (s.error_number != 0) {
+        errno = s.error_number;
+        return -1;
+    }
+
+    // Success
+    return 0;
+}
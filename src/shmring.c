@@ -0,0 +1,228 @@
+#define _GNU_SOURCE // memfd_create(), syscall()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <shmring.h>
+
+// Wait on the shared futex 'addr' while it contains 'val'
+static void futex_wait(unsigned int *addr, unsigned int val) {
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, NULL, NULL, 0);
+}
+
+// Wake up all the waiters on the shared futex 'addr'
+static void futex_wake(unsigned int *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/*  Initialize a ring of 'n_slots' slots (a power of 2, at least 2) in a shared memory region, inherited by fork().
+ *
+ *  RETURN VALUE: pointer to the new ring on success
+ *                NULL on error (errno is set)
+ */
+ShmRing_t *initShmRing(size_t n_slots) {
+    // Check size
+    if ((n_slots < 2) || ((n_slots & (n_slots - 1)) != 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Create the shared memory region
+    size_t map_size = sizeof(ShmRing_t) + n_slots * sizeof(RingSlot_t);
+    int mfd;
+
+    if ((mfd = memfd_create("farm-ring", MFD_CLOEXEC)) == -1)
+        return NULL;
+
+    if (ftruncate(mfd, map_size) == -1) {
+        int errsv = errno;
+        close(mfd);
+        errno = errsv;
+        return NULL;
+    }
+
+    ShmRing_t *r;
+
+    if ((r = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0)) == MAP_FAILED) {
+        int errsv = errno;
+        close(mfd);
+        errno = errsv;
+        return NULL;
+    }
+
+    // The mapping keeps the region alive
+    close(mfd);
+
+    // Create the eventfd used to wake up the consumer
+    if ((r->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+        int errsv = errno;
+        munmap(r, map_size);
+        errno = errsv;
+        return NULL;
+    }
+
+    // Init variables, slot i is free for the producer that claims position i
+    r->tail = 0;
+    r->head = 0;
+    r->space_seq = 0;
+    r->space_waiters = 0;
+    r->consumer_sleeping = 0;
+    r->mask = n_slots - 1;
+    r->map_size = map_size;
+
+    for (size_t i = 0; i < n_slots; i++)
+        r->slots[i].seq = i;
+
+    // Return pointer to the ring
+    return r;
+}
+
+// Delete a ring allocated with initShmRing() pointed to by r, in the calling process
+void deleteShmRing(ShmRing_t *r) {
+    if (r != NULL) {
+        close(r->efd);
+        munmap(r, r->map_size);
+    }
+}
+
+/*  Insert the 'result' of the submission number 'submission' of the file of ID 'id' into the ring pointed to by r,
+ *  wait if the ring is full. Safe to call from many threads.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int pushShmRing(ShmRing_t *r, uint64_t id, uint64_t submission, long result) {
+    // Check ring pointer
+    if (r == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    RingSlot_t *slot;
+    size_t pos, seq;
+    unsigned int space;
+
+    // Claim a slot
+    pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+
+    while (1) {
+        slot = &r->slots[pos & r->mask];
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == pos) {
+            // Slot free, try to advance the tail
+            if (__atomic_compare_exchange_n(&r->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if ((intptr_t) (seq - pos) < 0) {
+            // Ring full, wait until the consumer frees a slot
+            space = __atomic_load_n(&r->space_seq, __ATOMIC_ACQUIRE);
+            __atomic_add_fetch(&r->space_waiters, 1, __ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) == seq)
+                futex_wait(&r->space_seq, space);
+
+            __atomic_sub_fetch(&r->space_waiters, 1, __ATOMIC_SEQ_CST);
+            pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+        } else {
+            // Slot claimed by another producer
+            pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    // Fill and publish the slot
+    slot->result = result;
+    slot->id = id;
+    slot->submission = submission;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    // Wake up the consumer if it is waiting for any result, or for a half full ring
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    int sleeping = __atomic_load_n(&r->consumer_sleeping, __ATOMIC_RELAXED);
+
+    if (sleeping == RING_LAZY)
+        sleeping = (pos + 1 - __atomic_load_n(&r->head, __ATOMIC_RELAXED) > (r->mask + 1) / 2);
+
+    if (sleeping && __atomic_exchange_n(&r->consumer_sleeping, 0, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+
+        while (write(r->efd, &one, sizeof(one)) == -1) {
+            // EAGAIN: the counter is already non zero
+            if (errno != EINTR) break;
+        }
+    }
+
+    // Success
+    return 0;
+}
+
+/*  Pull a result from the ring pointed to by r, with the ID of its file and its submission number.
+ *  Only one thread may pull from the ring.
+ *
+ *  RETURN VALUE: 1 on success
+ *                0 on empty ring
+ */
+int popShmRing(ShmRing_t *r, uint64_t *id, uint64_t *submission, long *result) {
+    size_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    RingSlot_t *slot = &r->slots[pos & r->mask];
+
+    // Check if the slot has been published
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+        return 0;
+
+    *result = slot->result;
+    *id = slot->id;
+    *submission = slot->submission;
+
+    // Free the slot for the producer of the next round
+    __atomic_store_n(&slot->seq, pos + r->mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->head, pos + 1, __ATOMIC_RELAXED);
+
+    // Wake up the producers waiting for a free slot
+    __atomic_add_fetch(&r->space_seq, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&r->space_waiters, __ATOMIC_SEQ_CST) != 0)
+        futex_wake(&r->space_seq);
+
+    return 1;
+}
+
+/*  Announce that the consumer is about to wait on 'efd', producers will write to it.
+ *  If 'lazy' is not zero producers write to 'efd' only when the ring is half full, the consumer must wait with a timeout.
+ *
+ *  RETURN VALUE: 1 if the consumer can wait
+ *                0 if the ring is not empty, the consumer must not wait
+ */
+int sleepShmRing(ShmRing_t *r, int lazy) {
+    size_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&r->consumer_sleeping, lazy ? RING_LAZY : RING_SLEEPING, __ATOMIC_SEQ_CST);
+
+    // A lazy consumer wakes up anyway
+    if (lazy) return 1;
+
+    // Check again after the announcement, a producer that published before it will not write to 'efd'
+    if (__atomic_load_n(&r->slots[pos & r->mask].seq, __ATOMIC_SEQ_CST) == pos + 1) {
+        __atomic_store_n(&r->consumer_sleeping, 0, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    return 1;
+}
+
+// The consumer is awake: stop the wake ups and reset 'efd'
+void awakeShmRing(ShmRing_t *r) {
+    uint64_t counter;
+
+    // If the flag was already cleared a producer has written (or is writing) to 'efd'
+    if (__atomic_exchange_n(&r->consumer_sleeping, 0, __ATOMIC_SEQ_CST) == 0) {
+        while ((read(r->efd, &counter, sizeof(counter)) == -1) && (errno == EINTR));
+    }
+}
@@ -0,0 +1,268 @@
+#define _POSIX_C_SOURCE 200112L // pthread_condattr_setclock(), struct timespec
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <utils.h>
+#include <stream.h>
+
+/*  Initialize a stream holding at most about 'capacity' filenames, 0 for no limit, pulled in the order 'order'.
+ *
+ *  RETURN VALUE: pointer to the new stream on success
+ *                NULL on error (errno is set)
+ */
+FileStream_t *initStream(size_t capacity, QueueOrder_t order) {
+    // Allocate stream data structure
+    FileStream_t *s;
+
+    if ((s = malloc(sizeof(FileStream_t))) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
+        errno = errsv;
+        return NULL;
+    }
+
+    if ((s->files = initQueue(order)) == NULL) {
+        int errsv = errno;
+        free(s);
+        errno = errsv;
+        return NULL;
+    }
+
+    int error_number;
+
+    if ((error_number = pthread_mutex_init(&s->mutex, NULL)) != 0) {
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_mutex_init()\n");
+        deleteQueue(s->files);
+        free(s);
+        errno = error_number;
+        return NULL;
+    }
+
+    // The consumer waits with timeouts of the CLOCK_MONOTONIC clock
+    pthread_condattr_t attr;
+
+    if ((error_number = pthread_condattr_init(&attr)) != 0) {
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_condattr_init()\n");
+        pthread_mutex_destroy(&s->mutex);
+        deleteQueue(s->files);
+        free(s);
+        errno = error_number;
+        return NULL;
+    }
+
+    // The attributes are no longer needed once the condition variable is initialized, also on error
+    if (((error_number = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC)) != 0) || ((error_number = pthread_cond_init(&s->not_empty, &attr)) != 0)) {
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_cond_init()\n");
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_destroy(&s->mutex);
+        deleteQueue(s->files);
+        free(s);
+        errno = error_number;
+        return NULL;
+    }
+
+    pthread_condattr_destroy(&attr);
+
+    if ((error_number = pthread_cond_init(&s->not_full, NULL)) != 0) {
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_cond_init()\n");
+        pthread_cond_destroy(&s->not_empty);
+        pthread_mutex_destroy(&s->mutex);
+        deleteQueue(s->files);
+        free(s);
+        errno = error_number;
+        return NULL;
+    }
+
+    // Init variables
+    s->capacity = capacity;
+    s->closed = 0;
+    s->cancelled = 0;
+    s->error_number = 0;
+
+    // Return pointer to the stream
+    return s;
+}
+
+// Delete a stream allocated with initStream() pointed to by s, the remaining filenames are deleted
+void deleteStream(FileStream_t *s) {
+    if (s != NULL) {
+        deleteQueue(s->files);
+        pthread_cond_destroy(&s->not_full);
+        pthread_cond_destroy(&s->not_empty);
+        pthread_mutex_destroy(&s->mutex);
+        free(s);
+    }
+}
+
+/*  Move all the filenames of the queue 'files' at the end of the stream pointed to by s, waiting while the stream is full.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set to ECANCELED if the consumer has cancelled the stream)
+ */
+int appendStream(FileStream_t *s, Queue_t *files) {
+    // Check arguments
+    if ((s == NULL) || (files == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int error_number;
+
+    LOCK_RETURN(&s->mutex, error_number, -1)
+
+    // Wait until the consumer makes room, a batch may exceed the capacity
+    while ((s->capacity != 0) && (lengthQueue(s->files) >= s->capacity) && !s->cancelled)
+        WAIT_RETURN(&s->not_full, &s->mutex, error_number, -1)
+
+    if (s->cancelled) {
+        UNLOCK_RETURN(&s->mutex, error_number, -1)
+        errno = ECANCELED;
+        return -1;
+    }
+
+    if (appendQueue(s->files, files) == -1) {
+        int errsv = errno;
+        pthread_mutex_unlock(&s->mutex);
+        errno = errsv;
+        return -1;
+    }
+
+    SIGNAL_RETURN(&s->not_empty, error_number, -1)
+    UNLOCK_RETURN(&s->mutex, error_number, -1)
+
+    // Success
+    return 0;
+}
+
+/*  Pull filename from the stream, its version is stored in 'key', if 'abstime' is not NULL wait at most until 'abstime'.
+ *
+ *  RETURN VALUE: pointer to the filename on success
+ *                NULL at the end of the stream (errno is set to 0), on timeout or on error (errno is set)
+ */
+static char *pop(FileStream_t *s, FileKey_t *key, const struct timespec *abstime) {
+    // Check arguments
+    if ((s == NULL) || (key == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int error_number;
+    char *filename = NULL;
+
+    LOCK_RETURN(&s->mutex, error_number, NULL)
+
+    while ((lengthQueue(s->files) == 0) && !s->closed) {
+        if (abstime == NULL) {
+            WAIT_RETURN(&s->not_empty, &s->mutex, error_number, NULL)
+        } else if ((error_number = pthread_cond_timedwait(&s->not_empty, &s->mutex, abstime)) == ETIMEDOUT) {
+            break;
+        } else if (error_number != 0) {
+            fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_cond_timedwait()\n");
+            pthread_mutex_unlock(&s->mutex);
+            errno = error_number;
+            return NULL;
+        }
+    }
+
+    if (lengthQueue(s->files) != 0) {
+        filename = popQueue(s->files, key);
+
+        // Wake up a producer waiting for room
+        if ((s->capacity != 0) && (lengthQueue(s->files) < s->capacity))
+            SIGNAL_RETURN(&s->not_full, error_number, NULL)
+
+        error_number = 0;
+    } else if (s->closed) {
+        // End of the stream
+        error_number = s->error_number;
+    } else {
+        error_number = ETIMEDOUT;
+    }
+
+    int errsv = error_number;
+
+    UNLOCK_RETURN(&s->mutex, error_number, NULL)
+
+    errno = errsv;
+    return filename;
+}
+
+/*  Pull filename from the stream, waiting while it is empty, its version is stored in 'key'.
+ *
+ *  RETURN VALUE: pointer to the filename on success
+ *                NULL at the end of the stream (errno is set to 0) or on error (errno is set)
+ */
+char *popStream(FileStream_t *s, FileKey_t *key) {
+    return pop(s, key, NULL);
+}
+
+/*  Pull filename from the stream, its version is stored in 'key', waiting at most until the absolute time 'abstime' of the CLOCK_MONOTONIC clock.
+ *
+ *  RETURN VALUE: pointer to the filename on success
+ *                NULL at the end of the stream (errno is set to 0), on timeout (errno is set to ETIMEDOUT) or on error (errno is set)
+ */
+char *timedPopStream(FileStream_t *s, FileKey_t *key, const struct timespec *abstime) {
+    // Check time pointer
+    if (abstime == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return pop(s, key, abstime);
+}
+
+/*  End the stream pointed to by s, 'error_number' is the error of the producers (0 if none).
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int closeStream(FileStream_t *s, int error_number) {
+    // Check stream pointer
+    if (s == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int err;
+
+    LOCK_RETURN(&s->mutex, err, -1)
+
+    s->closed = 1;
+    s->error_number = error_number;
+
+    pthread_cond_broadcast(&s->not_empty);
+
+    UNLOCK_RETURN(&s->mutex, err, -1)
+
+    // Success
+    return 0;
+}
+
+/*  Cancel the stream pointed to by s, the producers waiting on it fail with ECANCELED.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int cancelStream(FileStream_t *s) {
+    // Check stream pointer
+    if (s == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int error_number;
+
+    LOCK_RETURN(&s->mutex, error_number, -1)
+
+    s->cancelled = 1;
+
+    pthread_cond_broadcast(&s->not_full);
+
+    UNLOCK_RETURN(&s->mutex, error_number, -1)
+
+    // Success
+    return 0;
+}
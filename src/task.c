@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <utils.h>
+#include <mempool.h>
+#include <queue.h>
+#include <task.h>
+
+// Recycled files and tasks, allocated by the Master and freed by the Workers
+static MemPool_t file_pool = MEMPOOL_INITIALIZER(sizeof(File_t));
+static MemPool_t task_pool = MEMPOOL_INITIALIZER(sizeof(Task_t));
+
+/*  Initialize the file of ID 'id' and submission number 'submission' that will be split in 'n_tasks' tasks, 'filename' is returned by popQueue() and owned by the file.
+ *  'entry' is the entry of the file in the cache of the results, filled with its result, NULL if none.
+ *  'result' is the result of the bytes of the file that are not read, the partial results of the tasks are added to it.
+ *
+ *  RETURN VALUE: pointer to the new file on success
+ *                NULL on error (errno is set)
+ */
+File_t *initFile(char filename[], uint64_t id, uint64_t submission, CacheEntry_t *entry, long result, size_t n_tasks) {
+    // Check arguments
+    if ((filename == NULL) || (n_tasks == 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Allocate file data structure
+    File_t *f;
+
+    if ((f = allocMemPool(&file_pool, sizeof(File_t))) == NULL) return NULL;
+
+    int error_number;
+
+    // Init mutex protecting the partial results
+    if ((error_number = pthread_mutex_init(&f->mutex, NULL)) != 0) {
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_mutex_init()\n");
+        freeMemPool(f);
+        errno = error_number;
+        return NULL;
+    }
+
+    // Init variables
+    f->filename = filename;
+    f->id = id;
+    f->submission = submission;
+    f->entry = entry;
+    f->pending = n_tasks;
+    f->result = result;
+    f->failed = 0;
+
+    // Return pointer to the file
+    return f;
+}
+
+// Delete a file allocated with initFile() pointed to by f, 'filename' is freed with freeFilename()
+void deleteFile(File_t *f) {
+    if (f != NULL) {
+        pthread_mutex_destroy(&f->mutex);
+        freeFilename(f->filename);
+        freeMemPool(f);
+    }
+}
+
+/*  Initialize a task of 'nelem' numbers of 'file' starting from the number of index 'offset'.
+ *
+ *  RETURN VALUE: pointer to the new task on success
+ *                NULL on error (errno is set)
+ */
+Task_t *initTask(File_t *file, off_t offset, size_t nelem) {
+    // Check arguments
+    if ((file == NULL) || (offset < 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Allocate task data structure
+    Task_t *t;
+
+    if ((t = allocMemPool(&task_pool, sizeof(Task_t))) == NULL) return NULL;
+
+    // Init variables
+    t->file = file;
+    t->offset = offset;
+    t->nelem = nelem;
+
+    // Return pointer to the task
+    return t;
+}
+
+/*  Merge the 'partial' result of 'n_tasks' tasks into the file pointed to by f.
+ *
+ *  RETURN VALUE: pointer to the file if they were its last pending tasks
+ *                NULL otherwise
+ */
+static File_t *mergeFile(File_t *f, size_t n_tasks, long partial, int failed) {
+    size_t pending;
+    int error_number;
+
+    LOCK_EXIT(&f->mutex, error_number, 0)
+
+    // The result is linear in the numbers: partial results of disjoint ranges add up, wrapping around
+    f->result = (long) ((unsigned long) f->result + (unsigned long) partial);
+    f->failed |= failed;
+    f->pending -= n_tasks;
+    pending = f->pending;
+
+    UNLOCK_EXIT(&f->mutex, error_number, 0)
+
+    return (pending == 0) ? f : NULL;
+}
+
+/*  Merge the 'partial' result of the task pointed to by t into its file, 'failed' marks the file as failed.
+ *  The task is freed.
+ *
+ *  RETURN VALUE: pointer to the file if t was its last pending task, the caller must delete it
+ *                NULL otherwise
+ */
+File_t *completeTask(Task_t *t, long partial, int failed) {
+    File_t *f = t->file;
+
+    freeMemPool(t);
+
+    return mergeFile(f, 1, partial, failed);
+}
+
+// Delete a task allocated with initTask() pointed to by t without executing it, the file is marked as failed
+void deleteTask(Task_t *t) {
+    if (t != NULL) {
+        File_t *f;
+
+        if ((f = completeTask(t, 0, 1)) != NULL) deleteFile(f);
+    }
+}
+
+/*  Cancel 'n_tasks' tasks of the file pointed to by f that will never be created, the file is marked as failed.
+ *  The file is deleted if it has no more pending tasks.
+ */
+void cancelTasks(File_t *f, size_t n_tasks) {
+    if ((f != NULL) && (n_tasks != 0)) {
+        if (mergeFile(f, n_tasks, 0, 1) != NULL) deleteFile(f);
+    }
+}
@@ -1,18 +1,604 @@
+#define _GNU_SOURCE // fileno(), madvise()
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
 #include <utils.h>
+#include <kernel.h>
+#include <shmring.h>
+#include <collector.h>
+#include <queue.h>
+#include <uring.h>
 #include <threadpool.h>
 
-// Worker thread arguments
+// Files of at least MMAP_THRESHOLD bytes are read with mmap() by the ENGINE_AUTO engine
+#define MMAP_THRESHOLD (4 * 1024 * 1024)
+
+// Number of elements read at a time by the fread() engine
+#define STDIO_BLOCK 4096
+
+// Size of the window mapped at a time, bounds the RSS of a Worker thread on huge files
+#define MMAP_WINDOW (64 * 1024 * 1024)
+
+// Bytes read at a time by the io_uring engine, each file in flight has two buffers so the next read overlaps the calculation
+#define URING_BLOCK (128 * 1024)
+
+// Maximum time in milliseconds a result waits in the buffer of a Worker thread before it is sent
+#define BATCH_LATENCY 10
+
+// Time in milliseconds an idle Worker thread waits on its inbox before trying to steal again, doubled up to the maximum
+#define STEAL_BACKOFF_MIN 1
+#define STEAL_BACKOFF_MAX 64
+
+// Results not yet sent to the Collector process, one buffer for each Worker thread, with the time limit of its oldest result
+typedef struct ResultBuffer {
+    ResultBatch_t batch;
+    struct timespec deadline;
+} ResultBuffer_t;
+
+// Work stealing state of a Worker thread
+typedef struct Stealer {
+    size_t self;
+    size_t n_workers;
+    Deque_t **deques;
+    int exiting;
+    long backoff;
+} Stealer_t;
+
+// Worker thread arguments, 'tasks' is the shared queue or the inbox of the Worker thread, 'deques' is NULL without work stealing
 typedef struct Args {
     int tid;
     ConcurrentQueue_t *tasks;
+    Deque_t **deques;
+    size_t n_workers;
+    ReadEngine_t engine;
+    size_t uring_depth;
     int collector_fd;
-    pthread_mutex_t *collector_fd_mutex;
+    ShmRing_t *ring;
 } Args_t;
 
+/*  File in flight with the io_uring engine: 'op' is the operation in flight on it, the reads cover the range
+ *  from 'position' to 'end' (-1 for the end of the file) alternating between the two buffers, 'current' is the one being read.
+ *  The last completed read holds 'n' numbers of index 'index' in the other buffer.
+ */
+typedef struct UringSlot {
+    Task_t *task;
+    int fd;
+    int op;
+    off_t position;
+    off_t end;
+    size_t len;
+    long result;
+    int failed;
+    int current;
+    char *buffers[2];
+    size_t n;
+    long index;
+} UringSlot_t;
+
+/*  Calculate the result of 'nelem' numbers starting from the number of index 'offset' 
+ *  of the binary file opened on 'stream' reading it with fread().
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error
+ */
+static int compute_stdio(FILE *stream, off_t offset, size_t nelem, long *result) {
+    long numbers[STDIO_BLOCK], i = offset;
+    size_t n, n_left = nelem;
+
+    *result = 0;
+
+    // Move to the first number of the range
+    if ((offset != 0) && (fseeko(stream, offset * sizeof(long), SEEK_SET) == -1))
+        return -1;
+
+    while ((n_left != 0) && ((n = fread(numbers, sizeof(long), (n_left < STDIO_BLOCK) ? n_left : STDIO_BLOCK, stream)) != 0)) {
+        *result = (long) ((unsigned long) *result + (unsigned long) weightedSum(numbers, n, i));
+        i += n;
+        n_left -= n;
+    }
+
+    // Check if an error occurs in fread()
+    return ((n_left == 0) || (feof(stream) != 0)) ? 0 : -1;
+}
+
+// Jump buffer of the window read by compute_mmap() in each Worker thread, NULL outside of the calculation
+static __thread sigjmp_buf *sigbus_env = NULL;
+
+// Signal handler established for signal SIGBUS, raised by the access to the pages of a mapped file that has been truncated
+static void sigbus_handler(int signo) {
+    // The calculation over the window is abandoned, the file is reported as failed
+    if (sigbus_env != NULL) siglongjmp(*sigbus_env, 1);
+
+    // SIGBUS not raised by compute_mmap(), terminate with the default action
+    signal(signo, SIG_DFL);
+    raise(signo);
+}
+
+/*  Calculate in 'sum' the weighted sum of the 'n' numbers of the mapped window 'numbers', the first of index 'base'.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 if SIGBUS is raised, the window is beyond the end of the file
+ */
+static int sum_window(const long numbers[], size_t n, long base, long *sum) {
+    sigjmp_buf env;
+
+    // The mask of the signals is restored, SIGBUS is blocked in the signal handler
+    if (sigsetjmp(env, 1) != 0) {
+        sigbus_env = NULL;
+        return -1;
+    }
+
+    sigbus_env = &env;
+    *sum = weightedSum(numbers, n, base);
+    sigbus_env = NULL;
+
+    return 0;
+}
+
+/*  Calculate the result of 'nelem' numbers starting from the number of index 'offset' 
+ *  of the binary file of 'size' bytes opened on 'fd' mapping it in memory.
+ *  The range is mapped one window of MMAP_WINDOW bytes at a time, every window is unmapped
+ *  as soon as it has been consumed.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set, EIO if the file is truncated while it is mapped)
+ */
+static int compute_mmap(int fd, off_t size, off_t offset, size_t nelem, long *result) {
+    long page_size = sysconf(_SC_PAGESIZE), i = offset, sum;
+    off_t start = offset * sizeof(long), end = size, aligned;
+    size_t window, delta, n;
+    char *map;
+
+    *result = 0;
+
+    // Bytes of the range that are in the file
+    if ((nelem != TASK_TO_EOF) && (start < size) && (nelem < (size_t) (size - start) / sizeof(long)))
+        end = start + nelem * sizeof(long);
+
+    for (off_t position = start; position < end; position += window) {
+        window = ((end - position) < MMAP_WINDOW) ? (size_t) (end - position) : MMAP_WINDOW;
+
+        // The offset of mmap() must be a multiple of the page size
+        aligned = position - (position % page_size);
+        delta = position - aligned;
+
+        if ((map = mmap(NULL, delta + window, PROT_READ, MAP_PRIVATE, fd, aligned)) == MAP_FAILED)
+            return -1;
+
+        // Hints only, failures are not fatal (e.g. MADV_HUGEPAGE on kernels without THP for files)
+        madvise(map, delta + window, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        madvise(map, delta + window, MADV_HUGEPAGE);
+#endif
+
+        // Calculate the result over the window
+        n = window / sizeof(long);
+
+        if (sum_window((long*) (map + delta), n, i, &sum) == -1) {
+            munmap(map, delta + window);
+            errno = EIO;
+            return -1;
+        }
+
+        *result = (long) ((unsigned long) *result + (unsigned long) sum);
+        i += n;
+
+        // Release the pages of the window
+        if (munmap(map, delta + window) == -1)
+            return -1;
+    }
+
+    // Success
+    return 0;
+}
+
+// Send the results in the buffer 'rb' to the Collector process as one batch with a single writev()
+static void flush_results(ResultBuffer_t *rb, int collector_fd, int tid) {
+    // The channel belongs to this Worker thread, no synchronization is needed
+    if (flushResults(&rb->batch, collector_fd) == -1) {
+        int errsv = errno;
+        fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m writevn() 'batch': ", tid);
+        errno = errsv;
+        perror(NULL);
+        exit(errsv);
+    }
+}
+
+// Compare the times 'a' and 'b', return a negative, zero or positive value as 'a' is before, equal or after 'b'
+static int compare_time(const struct timespec *a, const struct timespec *b) {
+    if (a->tv_sec != b->tv_sec) return (a->tv_sec < b->tv_sec) ? -1 : 1;
+    if (a->tv_nsec != b->tv_nsec) return (a->tv_nsec < b->tv_nsec) ? -1 : 1;
+    return 0;
+}
+
+/*  Get the next task of a Worker thread with work stealing: from its own deque, refilled from its 'inbox',
+ *  otherwise from the deques of the other Worker threads. An idle Worker thread waits on its inbox at most until 'deadline'
+ *  if not NULL, and tries to steal again with an increasing backoff.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on termination (errno is 0), when 'deadline' expires (errno is set to ETIMEDOUT) or on error (errno is set)
+ */
+static Task_t *steal_task(Stealer_t *st, ConcurrentQueue_t *inbox, const struct timespec *deadline) {
+    Deque_t *own = st->deques[st->self];
+    Task_t *task;
+    struct timespec now, abstime;
+
+    while (1) {
+        // Move the tasks of the inbox into the own deque, where the other Worker threads can steal them
+        while (!st->exiting && (sizeDeque(own) <= (size_t) own->mask)) {
+            errno = 0;
+
+            if ((task = tryPopConcurrentQueue(inbox)) != NULL) {
+                pushDeque(own, task);
+            } else if (errno == EAGAIN) {
+                break;
+            } else if (errno == 0) {
+                // Termination request, complete the tasks of the own deque first
+                st->exiting = 1;
+            } else {
+                return NULL;
+            }
+        }
+
+        // Pop from the bottom of the own deque, then steal from the top of the others
+        if ((task = popDeque(own)) == NULL) {
+            for (size_t i = 1; (task == NULL) && (i < st->n_workers); i++)
+                task = stealDeque(st->deques[(st->self + i) % st->n_workers]);
+        }
+
+        if (task != NULL) {
+            st->backoff = STEAL_BACKOFF_MIN;
+            return task;
+        }
+
+        if (st->exiting) {
+            errno = 0;
+            return NULL;
+        }
+
+        // Nothing to do, wait on the inbox until the backoff or the deadline expires
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        abstime.tv_sec = now.tv_sec + st->backoff / 1000;
+        abstime.tv_nsec = now.tv_nsec + (st->backoff % 1000) * 1000000;
+
+        if (abstime.tv_nsec >= 1000000000) {
+            abstime.tv_sec++;
+            abstime.tv_nsec -= 1000000000;
+        }
+
+        if ((deadline != NULL) && (compare_time(deadline, &abstime) < 0))
+            abstime = *deadline;
+
+        errno = 0;
+
+        if ((task = timedPopConcurrentQueue(inbox, &abstime)) != NULL) {
+            st->backoff = STEAL_BACKOFF_MIN;
+            return task;
+        } else if (errno == 0) {
+            st->exiting = 1;
+        } else if (errno != ETIMEDOUT) {
+            return NULL;
+        } else if ((deadline != NULL) && (compare_time(deadline, &abstime) == 0)) {
+            return NULL;
+        } else if (st->backoff < STEAL_BACKOFF_MAX) {
+            st->backoff *= 2;
+        }
+    }
+}
+
+/*  Get the next task of a Worker thread from the shared queue 'tasks', or with work stealing if 'st->deques' is not NULL.
+ *  Wait at most until 'deadline' if not NULL, do not wait at all if 'nowait' is not zero.
+ *
+ *  RETURN VALUE: pointer to the task on success
+ *                NULL on termination (errno is 0), when 'deadline' expires (errno is set to ETIMEDOUT),
+ *                if there are no tasks and 'nowait' is not zero (errno is set to EAGAIN or ETIMEDOUT) or on error (errno is set)
+ */
+static Task_t *next_task(Stealer_t *st, ConcurrentQueue_t *tasks, const struct timespec *deadline, int nowait) {
+    // A deadline already expired makes the Worker thread give up as soon as there is nothing to steal
+    static const struct timespec expired = { 0, 0 };
+
+    errno = 0;
+
+    if (st->deques != NULL)
+        return steal_task(st, tasks, nowait ? &expired : deadline);
+    else if (nowait)
+        return tryPopConcurrentQueue(tasks);
+    else if (deadline != NULL)
+        return timedPopConcurrentQueue(tasks, deadline);
+    else
+        return popConcurrentQueue(tasks);
+}
+
+// The first result of the buffer 'rb' sets the time limit of the buffer, the buffer is sent once the limit has expired
+static void check_deadline(ResultBuffer_t *rb, int collector_fd, int tid) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (rb->batch.count == 1) {
+        rb->deadline.tv_sec = now.tv_sec + BATCH_LATENCY / 1000;
+        rb->deadline.tv_nsec = now.tv_nsec + (BATCH_LATENCY % 1000) * 1000000;
+
+        if (rb->deadline.tv_nsec >= 1000000000) {
+            rb->deadline.tv_sec++;
+            rb->deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    if (compare_time(&now, &rb->deadline) >= 0)
+        flush_results(rb, collector_fd, tid);
+}
+
+// Merge the partial 'result' of 'task' and publish the result of its file if it was the last task, 'failed' marks the file as failed
+static void finish_task(Task_t *task, long result, int failed, ResultBuffer_t *rb, int collector_fd, ShmRing_t *ring, int tid) {
+    File_t *file;
+    int sent;
+
+    // The Worker thread that completes the last task of the file sends the result and stores it in the cache
+    if ((file = completeTask(task, result, failed)) != NULL) {
+        if (!file->failed) {
+            storeCache(file->entry, file->result);
+
+            if ((sent = sendResult(ring, &rb->batch, collector_fd, file->id, file->submission, file->result)) == -1) {
+                int errsv = errno;
+                fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m sendResult() '%s': ", tid, file->filename);
+                errno = errsv;
+                perror(NULL);
+                exit(errsv);
+            }
+
+            // A result in the buffer waits at most BATCH_LATENCY ms
+            if (sent == 1) check_deadline(rb, collector_fd, tid);
+        }
+
+        deleteFile(file);
+    }
+}
+
+// Get a submission queue entry of 'u', submitting the filled ones if the queue is full
+static struct io_uring_sqe *get_sqe(Uring_t *u, int tid) {
+    struct io_uring_sqe *sqe;
+
+    while ((sqe = getSqeUring(u)) == NULL) {
+        if (enterUring(u, 0) == -1) {
+            int errsv = errno;
+            fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m io_uring_enter(): ", tid);
+            errno = errsv;
+            perror(NULL);
+            exit(errsv);
+        }
+    }
+
+    return sqe;
+}
+
+// Queue the next read of the slot 'i' in its other buffer, or the close of its file at the end of the range
+static void prep_read(Uring_t *u, UringSlot_t slots[], size_t i, int fixed, int tid) {
+    UringSlot_t *slot = &slots[i];
+    struct io_uring_sqe *sqe = get_sqe(u, tid);
+    size_t len = URING_BLOCK;
+
+    if ((slot->end != -1) && ((off_t) len > slot->end - slot->position))
+        len = slot->end - slot->position;
+
+    sqe->fd = slot->fd;
+    sqe->user_data = i;
+
+    if (slot->failed || (len == 0)) {
+        sqe->opcode = IORING_OP_CLOSE;
+        slot->op = IORING_OP_CLOSE;
+        return;
+    }
+
+    slot->current = 1 - slot->current;
+    slot->len = len;
+
+    sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->addr = (uintptr_t) slot->buffers[slot->current];
+    sqe->len = len;
+    sqe->off = slot->position;
+    sqe->buf_index = 2 * i + slot->current;
+    slot->op = IORING_OP_READ;
+}
+
+/*  Code exec by a Worker thread with the io_uring engine: up to 'depth' files are in flight, each one is opened, read
+ *  and closed through the io_uring instance of the Worker thread, and the result is calculated on the buffers as they complete.
+ *
+ *  RETURN VALUE: 0 on termination
+ *                -1 if the io_uring instance cannot be created (errno is set), no task has been taken
+ */
+static int uring_worker(Stealer_t *st, ConcurrentQueue_t *tasks, size_t depth, ResultBuffer_t *rb, int collector_fd, ShmRing_t *ring, int tid) {
+    Uring_t u;
+    UringSlot_t *slots;
+    size_t *free_slots, *ready;
+    char *buffers;
+    struct iovec *iov;
+
+    if (initUring(&u, depth) == -1)
+        return -1;
+
+    if (((slots = calloc(depth, sizeof(UringSlot_t))) == NULL) || ((free_slots = malloc(depth * sizeof(size_t))) == NULL) ||
+        ((ready = malloc(depth * sizeof(size_t))) == NULL) || ((iov = malloc(2 * depth * sizeof(struct iovec))) == NULL) ||
+        ((errno = posix_memalign((void**) &buffers, sysconf(_SC_PAGESIZE), 2 * depth * URING_BLOCK)) != 0)) {
+        int errsv = errno;
+        fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m malloc(): ", tid);
+        errno = errsv;
+        perror(NULL);
+        exit(errsv);
+    }
+
+    for (size_t i = 0; i < depth; i++) {
+        slots[i].buffers[0] = buffers + 2 * i * URING_BLOCK;
+        slots[i].buffers[1] = buffers + (2 * i + 1) * URING_BLOCK;
+        iov[2 * i].iov_base = slots[i].buffers[0];
+        iov[2 * i].iov_len = URING_BLOCK;
+        iov[2 * i + 1].iov_base = slots[i].buffers[1];
+        iov[2 * i + 1].iov_len = URING_BLOCK;
+        free_slots[i] = depth - 1 - i;
+    }
+
+    // Registered buffers save the mapping of the pages at every read, plain reads are used if they exceed RLIMIT_MEMLOCK
+    int fixed = (registerBuffersUring(&u, iov, 2 * depth) == 0);
+
+    free(iov);
+
+    size_t n_free = depth, n_ready;
+    int exiting = 0;
+    struct io_uring_cqe *cqe;
+    struct timespec now;
+    UringSlot_t *slot;
+    Task_t *task;
+    int res;
+
+    while (1) {
+        // Start a file in every free slot, wait for a task only if no file is in flight
+        while (!exiting && (n_free != 0)) {
+            if ((task = next_task(st, tasks, (rb->batch.count != 0) ? &rb->deadline : NULL, n_free != depth)) == NULL) {
+                if ((errno == ETIMEDOUT) && (n_free == depth)) {
+                    flush_results(rb, collector_fd, tid);
+                    continue;
+                } else if ((errno == EAGAIN) || (errno == ETIMEDOUT)) {
+                    break;
+                } else if (errno == 0) {
+                    exiting = 1;
+                    break;
+                } else {
+                    int errsv = errno;
+                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m popConcurrentQueue(): ", tid);
+                    errno = errsv;
+                    perror(NULL);
+                    exit(errsv);
+                }
+            }
+
+            size_t i = free_slots[--n_free];
+            struct io_uring_sqe *sqe = get_sqe(&u, tid);
+
+            slot = &slots[i];
+            slot->task = task;
+            slot->position = task->offset * sizeof(long);
+            slot->end = (task->nelem == TASK_TO_EOF) ? -1 : (off_t) (slot->position + task->nelem * sizeof(long));
+            slot->result = 0;
+            slot->failed = 0;
+            slot->op = IORING_OP_OPENAT;
+
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uintptr_t) task->file->filename;
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = i;
+        }
+
+        // All the files are done
+        if (n_free == depth) {
+            if (exiting) break;
+            continue;
+        }
+
+        // Submit the new operations, wait only if there are no completions yet
+        if (enterUring(&u, (peekUring(&u) == NULL) ? 1 : 0) == -1) {
+            int errsv = errno;
+            fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m io_uring_enter(): ", tid);
+            errno = errsv;
+            perror(NULL);
+            exit(errsv);
+        }
+
+        // Advance every file with a completed operation
+        n_ready = 0;
+
+        while ((cqe = peekUring(&u)) != NULL) {
+            size_t i = cqe->user_data;
+
+            slot = &slots[i];
+            res = cqe->res;
+            seenUring(&u);
+
+            if (slot->op == IORING_OP_OPENAT) {
+                if (res < 0) {
+                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m openat() '%s': %s\n", tid, slot->task->file->filename, strerror(-res));
+                    finish_task(slot->task, 0, 1, rb, collector_fd, ring, tid);
+                    free_slots[n_free++] = i;
+                } else {
+                    slot->fd = res;
+                    slot->current = 1;
+                    prep_read(&u, slots, i, fixed, tid);
+                }
+            } else if (slot->op == IORING_OP_READ) {
+                if (res < 0) {
+                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m read() '%s': %s\n", tid, slot->task->file->filename, strerror(-res));
+                    slot->failed = 1;
+                    prep_read(&u, slots, i, fixed, tid);
+                } else {
+                    // A read of a regular file is short only at the end of the file, a trailing partial number is ignored
+                    slot->n = res / sizeof(long);
+                    slot->index = slot->position / sizeof(long);
+                    slot->position += slot->n * sizeof(long);
+
+                    if ((size_t) res < slot->len) slot->end = slot->position;
+
+                    // The next read goes to the other buffer, the completed one is calculated below
+                    prep_read(&u, slots, i, fixed, tid);
+                    ready[n_ready++] = i;
+                }
+            } else {
+                if (res < 0)
+                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m close() '%s': %s\n", tid, slot->task->file->filename, strerror(-res));
+
+                finish_task(slot->task, slot->result, slot->failed, rb, collector_fd, ring, tid);
+                free_slots[n_free++] = i;
+            }
+        }
+
+        // Submit the next reads before calculating, so they are in flight during the calculation
+        if ((n_ready != 0) && (enterUring(&u, 0) == -1)) {
+            int errsv = errno;
+            fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m io_uring_enter(): ", tid);
+            errno = errsv;
+            perror(NULL);
+            exit(errsv);
+        }
+
+        // The buffer just read is the other one of the slot
+        for (size_t j = 0; j < n_ready; j++) {
+            slot = &slots[ready[j]];
+
+            if (slot->n != 0) {
+                long *numbers = (long*) slot->buffers[(slot->op == IORING_OP_READ) ? 1 - slot->current : slot->current];
+                slot->result = (long) ((unsigned long) slot->result + (unsigned long) weightedSum(numbers, slot->n, slot->index));
+            }
+        }
+
+        // Send the buffered results once their time limit expires, a completion arrives at least every read
+        if (rb->batch.count != 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+
+            if (compare_time(&now, &rb->deadline) >= 0)
+                flush_results(rb, collector_fd, tid);
+        }
+    }
+
+    deleteUring(&u);
+    free(buffers);
+    free(ready);
+    free(free_slots);
+    free(slots);
+
+    return 0;
+}
+
 // Code exec by worker thread
 static void *worker_fun(void *arg) {
     // Check arg
@@ -27,119 +613,227 @@ static void *worker_fun(void *arg) {
     int tid = args->tid;
     int collector_fd = args-> collector_fd;
     ConcurrentQueue_t *tasks = args->tasks;
-    pthread_mutex_t *collector_fd_mutex = args->collector_fd_mutex;
+    ReadEngine_t engine = args->engine;
+    size_t uring_depth = args->uring_depth;
+    ShmRing_t *ring = args->ring;
+    Stealer_t stealer = { args->tid - 1, args->n_workers, args->deques, 0, STEAL_BACKOFF_MIN };
     
     free(args);
 
+    // Allocate the buffer of the results
+    ResultBuffer_t *rb;
+
+    if ((rb = malloc(sizeof(ResultBuffer_t))) == NULL) {
+        int errsv = errno;
+        fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m malloc(): ", tid);
+        errno = errsv;
+        perror(NULL);
+        exit(errsv);
+    }
+
+    rb->batch.count = 0;
+
     FILE *stream;
+    struct stat statbuf;
+    Task_t *task;
     char *filename;
-    long result, number, i;
-    int filename_size, error_number;
+    long result;
+    int use_mmap, failed;
+
+    // The io_uring engine runs until the termination, without an io_uring instance the Worker thread falls back to ENGINE_AUTO
+    if (engine == ENGINE_URING) {
+        if (uring_worker(&stealer, tasks, uring_depth, rb, collector_fd, ring, tid) == 0) {
+            task = NULL;
+            errno = 0;
+        } else {
+            int errsv = errno;
+            fprintf(stderr, "thread[%d]: \x1B[1;33mwarning:\x1B[0m io_uring not available (%s), using the auto engine\n", tid, strerror(errsv));
+            engine = ENGINE_AUTO;
+        }
+    }
 
     // Loop
-    while(1) {
-        // Pop 'filename' from the queue
-        if ((errno = 0, filename = popConcurrentQueue(tasks)) != NULL) {
-            // Open binary file 'filename'
-            if ((stream = fopen(filename, "rb")) != NULL) {
-                // Calculate the result
-                result = 0; i = 0;
-
-                while (fread(&number, sizeof(long), 1, stream) != 0) {
-                    result += i * number;
-                    i++;
-                }
+    while(engine != ENGINE_URING) {
+        // Pop 'task' from the queue, if there are buffered results wait at most until the time limit of the buffer
+        if ((task = next_task(&stealer, tasks, (rb->batch.count != 0) ? &rb->deadline : NULL, 0)) == NULL && errno == ETIMEDOUT) {
+            flush_results(rb, collector_fd, tid);
+            continue;
+        }
 
-                // Check if an error occurs in fread()
-                if (feof(stream) != 0) {
-                    // Length of 'filename' + '\0'
-                    filename_size = strlen(filename) + 1;
-
-                    LOCK_EXIT(collector_fd_mutex, error_number, tid)
-
-                    // Send length of 'filename' to Collector process
-                    if (writen(collector_fd, &filename_size, sizeof(int)) == -1) {
-                        int errsv = errno;
-                        fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m writen() 'filename_size': ", tid);
-                        errno = errsv;
-                        perror(NULL);
-                        exit(errsv);
-                    }
-
-                    // Send 'filename' to Collector process
-                    if (writen(collector_fd, filename, filename_size) == -1) {
-                        int errsv = errno;
-                        fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m writen() 'filename': ", tid);
-                        errno = errsv;
-                        perror(NULL);
-                        exit(errsv);
-                    }
-                    
-                    // Send result of 'filename' to Collector process
-                    if (writen(collector_fd, &result, sizeof(long)) == -1) {
-                        int errsv = errno;
-                        fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m writen() 'result': ", tid);
-                        errno = errsv;
-                        perror(NULL);
-                        exit(errsv);
-                    }
-
-                    UNLOCK_EXIT(collector_fd_mutex, error_number, tid)
-                } else {
-                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m fread() '%s'\n", tid, filename);
-                }
+        if (task == NULL) break;
+
+        filename = task->file->filename;
+        result = 0;
+        failed = 1;
+
+        // Open binary file 'filename'
+        if ((stream = fopen(filename, "rb")) != NULL) {
+            // Choose the read engine, fall back to fread() if the size of the file is unknown
+            use_mmap = 0;
 
-                // Close 'filename'
-                if (fclose(stream) == EOF) {
+            if ((engine != ENGINE_STDIO) && (fstat(fileno(stream), &statbuf) == 0))
+                use_mmap = (engine == ENGINE_MMAP) || (statbuf.st_size >= MMAP_THRESHOLD);
+
+            // Calculate the result of the range of the task
+            if (use_mmap) {
+                if (compute_mmap(fileno(stream), statbuf.st_size, task->offset, task->nelem, &result) == 0) {
+                    failed = 0;
+                } else {
                     int errsv = errno;
-                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m fclose() '%s': ", tid, filename);
+                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m mmap() '%s': ", tid, filename);
                     errno = errsv;
                     perror(NULL);
                 }
             } else {
-                int errsv = errno;
-                fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m fopen() '%s': ", tid, filename);
-                errno = errsv;
-                perror(NULL);
+                if (compute_stdio(stream, task->offset, task->nelem, &result) == 0)
+                    failed = 0;
+                else
+                    fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m fread() '%s'\n", tid, filename);
             }
 
-            free(filename);
-        } else {
-            // 'filename' == NULL
-            if (errno == 0) {
-                // Success
-                pthread_exit(NULL);
-            } else {
+            // Close 'filename'
+            if (fclose(stream) == EOF) {
                 int errsv = errno;
-                fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m popConcurrentQueue(): ", tid);
+                fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m fclose() '%s': ", tid, filename);
                 errno = errsv;
                 perror(NULL);
-                exit(errsv);
             }
+        } else {
+            int errsv = errno;
+            fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m fopen() '%s': ", tid, filename);
+            errno = errsv;
+            perror(NULL);
         }
+
+        // Merge the partial result
+        finish_task(task, result, failed, rb, collector_fd, ring, tid);
+    }
+
+    // 'task' == NULL
+    if (errno == 0) {
+        // Send the buffered results and close the channel
+        flush_results(rb, collector_fd, tid);
+        free(rb);
+        if (collector_fd != -1) close(collector_fd);
+
+        // Success
+        pthread_exit(NULL);
+    } else {
+        int errsv = errno;
+        fprintf(stderr, "thread[%d]: \x1B[1;31merror:\x1B[0m popConcurrentQueue(): ", tid);
+        errno = errsv;
+        perror(NULL);
+        exit(errsv);
     }
 }
 
+// Delete the queues and the deques of the thread pool 'pool', the remaining tasks are deleted
+static void delete_queues(Threadpool_t *pool) {
+    deleteConcurrentQueue(pool->tasks);
+
+    for (size_t i = 0; i < pool->n_workers; i++) {
+        if (pool->inboxes != NULL) deleteConcurrentQueue(pool->inboxes[i]);
+        if (pool->deques != NULL) deleteDeque(pool->deques[i]);
+    }
+
+    free(pool->inboxes);
+    free(pool->deques);
+}
+
+/*  Create the queues of the thread pool 'pool' of size 'queue_size': a shared queue or an inbox and a deque for each Worker thread.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+static int init_queues(Threadpool_t *pool, size_t queue_size) {
+    pool->tasks = NULL;
+    pool->inboxes = NULL;
+    pool->deques = NULL;
+
+    if (pool->scheduler == SCHEDULER_SHARED) {
+        if ((pool->tasks = initConcurrentQueue(queue_size)) == NULL) {
+            int errsv = errno;
+            fprintf(stderr, "\x1B[1;31merror:\x1B[0m initConcurrentQueue()\n");
+            errno = errsv;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (((pool->inboxes = calloc(pool->n_workers, sizeof(ConcurrentQueue_t*))) == NULL) ||
+        ((pool->deques = calloc(pool->n_workers, sizeof(Deque_t*))) == NULL)) {
+        int errsv = errno;
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m calloc()\n");
+        delete_queues(pool);
+        errno = errsv;
+        return -1;
+    }
+
+    for (size_t i = 0; i < pool->n_workers; i++) {
+        if (((pool->inboxes[i] = initConcurrentQueue(queue_size)) == NULL) || ((pool->deques[i] = initDeque(queue_size)) == NULL)) {
+            int errsv = errno;
+            fprintf(stderr, "\x1B[1;31merror:\x1B[0m initConcurrentQueue() / initDeque()\n");
+            delete_queues(pool);
+            errno = errsv;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Close the channels 'collector_fds[from]', ..., 'collector_fds[to - 1]' not owned by a Worker thread
+static void close_channels(int collector_fds[], size_t from, size_t to) {
+    if (collector_fds == NULL) return;
+
+    for (size_t i = from; i < to; i++)
+        close(collector_fds[i]);
+}
+
 /*  Create a new thread pool with 'pool_size' Worker threads and internal queue of size 'queue_size'. 
- *  Worker threads send results to file descriptor 'collector_fd'.
- *  The variable 'collector_fd_mutex' ensures correct synchronization between threads.
+ *  Tasks are scheduled with 'scheduler', with work stealing every Worker thread has an inbox and a deque of size 'queue_size'.
+ *  Files larger than 'chunk_size' bytes are split in tasks of 'chunk_size' bytes, 0 disables the splitting.
+ *  Worker threads read files with the 'engine' read engine, with ENGINE_URING each one keeps up to 'uring_depth' files in flight
+ *  and falls back to ENGINE_AUTO if it cannot create its io_uring instance. If 'ring' is not NULL Worker threads publish results
+ *  in the shared memory ring and 'collector_fds' may be NULL, otherwise the i-th Worker thread sends results to its own
+ *  channel 'collector_fds[i]' and closes it when it terminates. The channels are closed also on error.
  *
  *  RETURN VALUE: pointer to the new thread pool on success
  *                NULL on error (errno is set)
  */
-Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, int collector_fd, pthread_mutex_t *collector_fd_mutex) {
+Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, size_t chunk_size, ReadEngine_t engine, size_t uring_depth,
+                             Scheduler_t scheduler, int collector_fds[], ShmRing_t *ring) {
     // Check arguments
-    if((pool_size == 0) || (queue_size == 0) || (collector_fd < 0) || (collector_fd_mutex == NULL)) {
+    if((pool_size == 0) || (queue_size == 0) || ((engine == ENGINE_URING) && (uring_depth == 0)) || ((collector_fds == NULL) && (ring == NULL))) {
+        close_channels(collector_fds, 0, pool_size);
 	    errno = EINVAL;
         return NULL;
     }
     
+    // Install signal handler for signal SIGBUS, a file truncated while it is mapped fails instead of terminating the process
+    if (engine != ENGINE_STDIO) {
+        struct sigaction sa;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = sigbus_handler;
+
+        if (sigaction(SIGBUS, &sa, NULL) == -1) {
+            int errsv = errno;
+            fprintf(stderr, "\x1B[1;31merror:\x1B[0m sigaction() 'SIGBUS'\n");
+            close_channels(collector_fds, 0, pool_size);
+            errno = errsv;
+            return NULL;
+        }
+    }
+
     // Allocate thread pool data structure
     Threadpool_t *pool;
 
     if ((pool = malloc(sizeof(Threadpool_t))) == NULL) {
         int errsv = errno;
         fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
+        close_channels(collector_fds, 0, pool_size);
         errno = errsv;
         return NULL;
     }
@@ -148,24 +842,31 @@ Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, int collector_
     if ((pool->worker_threads = malloc(sizeof(pthread_t) * pool_size)) == NULL) {
         int errsv = errno;
         fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
+        close_channels(collector_fds, 0, pool_size);
         free(pool);
         errno = errsv;
 	    return NULL;
     }
 
-    // Create thread pool concurrent queue of size 'queue_size'
-    if ((pool->tasks = initConcurrentQueue(queue_size)) == NULL) {
-        free(pool->worker_threads);
-        free(pool);
+    pool->n_workers = pool_size;
+    pool->scheduler = scheduler;
+    pool->next_worker = 0;
 
+    // Create thread pool queues of size 'queue_size'
+    if (init_queues(pool, queue_size) == -1) {
         int errsv = errno;
-        fprintf(stderr, "\x1B[1;31merror:\x1B[0m initConcurrentQueue()\n");
+        free(pool->worker_threads);
+        free(pool);
+        close_channels(collector_fds, 0, pool_size);
         errno = errsv;
         return NULL;
     }
 
+    // Select the weighted sum kernel for the CPU
+    initKernel();
+
     // Init pool variables
-    pool->collector_fd_mutex = collector_fd_mutex;
+    pool->chunk_nelem = chunk_size / sizeof(long);
     pool->pool_size = 0;
 
     // Create Worker threads
@@ -176,6 +877,7 @@ Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, int collector_
         // Allocate space for Worker thread arguments
         if ((args = malloc(sizeof(Args_t))) == NULL) {
             int errsv = errno;
+            close_channels(collector_fds, i, pool_size);
             shutdownThreadPool(pool);
             fprintf(stderr, "\x1B[1;31merror:\x1B[0m malloc()\n");
             errno = errsv;
@@ -184,14 +886,19 @@ Threadpool_t *initThreadPool(size_t pool_size, size_t queue_size, int collector_
 
         // Init arguments
         args->tid = i + 1;
-        args->tasks = pool->tasks;
-        args->collector_fd = collector_fd;
-        args->collector_fd_mutex = collector_fd_mutex;
+        args->tasks = (pool->inboxes != NULL) ? pool->inboxes[i] : pool->tasks;
+        args->deques = pool->deques;
+        args->n_workers = pool->n_workers;
+        args->engine = engine;
+        args->uring_depth = uring_depth;
+        args->collector_fd = (collector_fds != NULL) ? collector_fds[i] : -1;
+        args->ring = ring;
 
         // Spawn Worker thread, exec 'worker_fun' function
         if((error_number = pthread_create(&pool->worker_threads[i], NULL, worker_fun, args)) != 0) {
             fprintf(stderr, "\x1B[1;31merror:\x1B[0m pthread_create()\n");
             free(args);
+            close_channels(collector_fds, i, pool_size);
             shutdownThreadPool(pool);
             errno = error_number;
             return NULL;
@@ -216,9 +923,9 @@ int shutdownThreadPool(Threadpool_t *pool) {
 	    return -1;
     }
 
-    // Insert a NULL pointer for each Worker thread in the thread pool queue
+    // Insert a NULL pointer for each Worker thread in the thread pool queue or in its inbox
     for(int i = 0; i < pool->pool_size; i++) {
-        if (pushConcurrentQueue(pool->tasks, NULL) != 0) {
+        if (pushConcurrentQueue((pool->inboxes != NULL) ? pool->inboxes[i] : pool->tasks, NULL) != 0) {
             int errsv = errno;
             fprintf(stderr, "\x1B[1;31merror:\x1B[0m pushConcurrentQueue()\n");
             errno = errsv;       
@@ -236,7 +943,7 @@ int shutdownThreadPool(Threadpool_t *pool) {
     }
 
     // Free thread pool resources
-    deleteConcurrentQueue(pool->tasks);
+    delete_queues(pool);
     free(pool->worker_threads);
     free(pool);
 
@@ -244,27 +951,105 @@ int shutdownThreadPool(Threadpool_t *pool) {
     return 0;
 }
 
-/*  Submit a new 'filename' for execution to the thread pool 'pool'. 
+// Hash (FNV-1a) of the directory of 'filename', the files given without directory share the same hash
+static size_t hash_dirname(const char filename[]) {
+    const char *last = strrchr(filename, '/');
+    size_t hash = 14695981039346656037UL;
+
+    for (const char *c = filename; (last != NULL) && (c < last); c++) {
+        hash ^= (unsigned char) *c;
+        hash *= 1099511628211UL;
+    }
+
+    return hash;
+}
+
+/*  Insert 'task' in the inbox of the Worker thread 'worker' of the thread pool 'pool'.
+ *  If the inbox is full try the inboxes of the other Worker threads, wait only if all of them are full.
  *
  *  RETURN VALUE: 0 on success
  *                -1 on error (errno is set)
  */
-int submitThreadPool(Threadpool_t *pool, char filename[]) {
+static int push_inbox(Threadpool_t *pool, Task_t *task, size_t worker) {
+    for (size_t i = 0; i < pool->n_workers; i++) {
+        if (tryPushConcurrentQueue(pool->inboxes[(worker + i) % pool->n_workers], task) == 0)
+            return 0;
+        else if (errno != EAGAIN)
+            return -1;
+    }
+
+    return pushConcurrentQueue(pool->inboxes[worker], task);
+}
+
+/*  Submit a new 'filename' of 'size' bytes, of ID 'id' in the table of the paths and of submission number 'submission'
+ *  for execution to the thread pool 'pool', its result is sent with the ID and the submission number.
+ *  The thread pool takes ownership of 'filename', returned by popQueue(), also on error.
+ *  The first 'offset' bytes of the file have the result 'result' and are not read, only the numbers from
+ *  the index offset / sizeof(long) are. If 'entry' is not NULL the result is stored in the entry of the file in the cache of the results.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int submitThreadPool(Threadpool_t *pool, char filename[], uint64_t id, uint64_t submission, off_t size, off_t offset, long result, CacheEntry_t *entry) {
     // Check arguments
-    if(pool == NULL || filename == NULL) {
+    if(pool == NULL || filename == NULL || size < 0 || offset < 0 || offset > size) {
+        freeFilename(filename);
 	    errno = EINVAL;
 	    return -1;
     }
 
-    // Insert 'filename' in the thread pool queue
-    if (pushConcurrentQueue(pool->tasks, filename) != 0) {
+    // Split the numbers to read in chunks of 'chunk_nelem' numbers
+    size_t first = offset / sizeof(long), nelem = size / sizeof(long) - first, n_tasks = 1;
+
+    if ((pool->chunk_nelem != 0) && (nelem > pool->chunk_nelem))
+        n_tasks = (nelem + pool->chunk_nelem - 1) / pool->chunk_nelem;
+
+    File_t *file;
+
+    if ((file = initFile(filename, id, submission, entry, result, n_tasks)) == NULL) {
         int errsv = errno;
-        fprintf(stderr, "\x1B[1;31merror:\x1B[0m pushConcurrentQueue()\n");
+        fprintf(stderr, "\x1B[1;31merror:\x1B[0m initFile()\n");
+        freeFilename(filename);
         errno = errsv;
         return -1;
     }
 
+    Task_t *task;
+    size_t worker = 0;
+
+    // Choose the Worker thread of the file: by directory or round-robin
+    if (pool->scheduler == SCHEDULER_LOCALITY)
+        worker = hash_dirname(filename) % pool->n_workers;
+
+    for (size_t i = 0; i < n_tasks; i++) {
+        if (pool->scheduler == SCHEDULER_RR)
+            worker = pool->next_worker++ % pool->n_workers;
+
+        // A file that is not split is read until the end
+        if (n_tasks == 1)
+            task = initTask(file, first, TASK_TO_EOF);
+        else
+            task = initTask(file, first + i * pool->chunk_nelem, (i == n_tasks - 1) ? (nelem - i * pool->chunk_nelem) : pool->chunk_nelem);
+
+        if (task == NULL) {
+            int errsv = errno;
+            fprintf(stderr, "\x1B[1;31merror:\x1B[0m initTask()\n");
+            cancelTasks(file, n_tasks - i);
+            errno = errsv;
+            return -1;
+        }
+
+        // Insert 'task' in the thread pool queue or in the inbox of a Worker thread
+        if (((pool->inboxes != NULL) ? push_inbox(pool, task, worker) : pushConcurrentQueue(pool->tasks, task)) != 0) {
+            int errsv = errno;
+            fprintf(stderr, "\x1B[1;31merror:\x1B[0m pushConcurrentQueue()\n");
+            cancelTasks(file, n_tasks - i - 1);
+            deleteTask(task);
+            errno = errsv;
+            return -1;
+        }
+    }
+
     // Success
     return 0;
 }
-
@@ -0,0 +1,210 @@
+#define _GNU_SOURCE // syscall()
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <uring.h>
+
+// Operations used by the Worker threads, checked by initUring()
+static const unsigned char required_ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_CLOSE };
+
+/*  Check that the kernel of the io_uring instance of 'fd' supports the required operations.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set, EOPNOTSUPP if an operation is not supported)
+ */
+static int probe_ops(int fd) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe;
+
+    if ((probe = calloc(1, size)) == NULL)
+        return -1;
+
+    // Kernels without IORING_REGISTER_PROBE do not have IORING_OP_OPENAT either
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == -1) {
+        free(probe);
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(required_ops); i++) {
+        if ((required_ops[i] > probe->last_op) || !(probe->ops[required_ops[i]].flags & IO_URING_OP_SUPPORTED)) {
+            free(probe);
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+    }
+
+    free(probe);
+    return 0;
+}
+
+/*  Initialize the io_uring instance pointed to by u with 'entries' submission queue entries,
+ *  the kernel must support the IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_READ_FIXED and IORING_OP_CLOSE operations.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set, EOPNOTSUPP if an operation is not supported)
+ */
+int initUring(Uring_t *u, unsigned entries) {
+    // Check arguments
+    if ((u == NULL) || (entries == 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct io_uring_params p;
+    long fd;
+
+    memset(&p, 0, sizeof(p));
+
+    if ((fd = syscall(__NR_io_uring_setup, entries, &p)) == -1)
+        return -1;
+
+    u->fd = fd;
+    u->sq_entries = p.sq_entries;
+    u->sq_map = MAP_FAILED;
+    u->cq_map = MAP_FAILED;
+    u->sqes = MAP_FAILED;
+
+    if (probe_ops(u->fd) == -1) {
+        int errsv = errno;
+        deleteUring(u);
+        errno = errsv;
+        return -1;
+    }
+
+    // Map the rings, a single mapping holds both of them if the kernel supports it
+    u->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) && (u->cq_map_size > u->sq_map_size))
+        u->sq_map_size = u->cq_map_size;
+
+    if ((u->sq_map = mmap(NULL, u->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING)) == MAP_FAILED) {
+        int errsv = errno;
+        deleteUring(u);
+        errno = errsv;
+        return -1;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_map = u->sq_map;
+    } else if ((u->cq_map = mmap(NULL, u->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING)) == MAP_FAILED) {
+        int errsv = errno;
+        deleteUring(u);
+        errno = errsv;
+        return -1;
+    }
+
+    if ((u->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES)) == MAP_FAILED) {
+        int errsv = errno;
+        deleteUring(u);
+        errno = errsv;
+        return -1;
+    }
+
+    // Init variables
+    u->sq_head = (unsigned*) ((char*) u->sq_map + p.sq_off.head);
+    u->sq_tail = (unsigned*) ((char*) u->sq_map + p.sq_off.tail);
+    u->sq_mask = (unsigned*) ((char*) u->sq_map + p.sq_off.ring_mask);
+    u->sq_array = (unsigned*) ((char*) u->sq_map + p.sq_off.array);
+    u->sqe_tail = *u->sq_tail;
+    u->cq_head = (unsigned*) ((char*) u->cq_map + p.cq_off.head);
+    u->cq_tail = (unsigned*) ((char*) u->cq_map + p.cq_off.tail);
+    u->cq_mask = (unsigned*) ((char*) u->cq_map + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe*) ((char*) u->cq_map + p.cq_off.cqes);
+
+    // Success
+    return 0;
+}
+
+// Delete the io_uring instance initialized with initUring() pointed to by u
+void deleteUring(Uring_t *u) {
+    if (u != NULL) {
+        if (u->sqes != MAP_FAILED) munmap(u->sqes, u->sq_entries * sizeof(struct io_uring_sqe));
+        if ((u->cq_map != MAP_FAILED) && (u->cq_map != u->sq_map)) munmap(u->cq_map, u->cq_map_size);
+        if (u->sq_map != MAP_FAILED) munmap(u->sq_map, u->sq_map_size);
+        close(u->fd);
+    }
+}
+
+/*  Register the 'n' buffers 'iov' in the io_uring instance pointed to by u, for IORING_OP_READ_FIXED.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int registerBuffersUring(Uring_t *u, const struct iovec iov[], unsigned n) {
+    // Check arguments
+    if ((u == NULL) || (iov == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return (syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_BUFFERS, iov, n) == -1) ? -1 : 0;
+}
+
+/*  Get a zeroed submission queue entry of the io_uring instance pointed to by u, to fill before the next enterUring().
+ *
+ *  RETURN VALUE: pointer to the entry on success
+ *                NULL if the submission queue is full
+ */
+struct io_uring_sqe *getSqeUring(Uring_t *u) {
+    // The kernel advances the head as it consumes the entries
+    if (u->sqe_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries)
+        return NULL;
+
+    unsigned index = u->sqe_tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+
+    u->sq_array[index] = index;
+    u->sqe_tail++;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+/*  Submit the entries filled since the last call and wait for at least 'min_complete' completions.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+int enterUring(Uring_t *u, unsigned min_complete) {
+    // Nothing to submit or to wait for
+    if ((min_complete == 0) && (u->sqe_tail == *u->sq_tail)) return 0;
+
+    // Publish the filled entries
+    __atomic_store_n(u->sq_tail, u->sqe_tail, __ATOMIC_RELEASE);
+
+    long ret;
+
+    // The entries consumed by the kernel before an interruption are not submitted again
+    do {
+        ret = syscall(__NR_io_uring_enter, u->fd, u->sqe_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE), min_complete,
+                      (min_complete != 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while ((ret == -1) && (errno == EINTR));
+
+    return (ret == -1) ? -1 : 0;
+}
+
+/*  Get the oldest completion queue entry of the io_uring instance pointed to by u, without waiting.
+ *
+ *  RETURN VALUE: pointer to the entry, valid until seenUring()
+ *                NULL if there are no completions
+ */
+struct io_uring_cqe *peekUring(Uring_t *u) {
+    unsigned head = *u->cq_head;
+
+    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    return &u->cqes[head & *u->cq_mask];
+}
+
+// Release the completion queue entry returned by peekUring()
+void seenUring(Uring_t *u) {
+    __atomic_store_n(u->cq_head, *u->cq_head + 1, __ATOMIC_RELEASE);
+}
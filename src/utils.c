@@ -1,5 +1,7 @@
 #include <utils.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
 
 /*  Read 'n' byte from file descriptor 'fd' into the buffer starting at 'buf'.
  *
@@ -55,6 +57,142 @@ int writen(int fd, void *buf, size_t n) {
 	    buf_char += n_write;
     }
 
+    // Success
+    return n;
+}
+
+/*  Write the 'iovcnt' buffers described by 'iov' to file descriptor 'fd', 'iov' is modified.
+ *
+ *  RETURN VALUE: number of bytes written on success
+ *                -1 on error (errno is set)
+ */
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt) {
+    ssize_t n_write, n_total = 0;
+
+    while (iovcnt > 0) {
+        if ((n_write = writev(fd, iov, iovcnt)) == -1) {
+            if (errno == EINTR)
+                continue;
+            else
+                // Error
+                return -1;
+        }
+
+        n_total += n_write;
+
+        // Skip the buffers completely written and advance the partially written one
+        while ((iovcnt > 0) && ((size_t) n_write >= iov->iov_len)) {
+            n_write -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0) {
+            iov->iov_base = (char*) iov->iov_base + n_write;
+            iov->iov_len -= n_write;
+        }
+    }
+
+    // Success
+    return n_total;
+}
+
+/*  Write 'n' byte from the buffer starting at 'buf' to UNIX socket 'fd', passing the file descriptor 'passed_fd' with them.
+ *
+ *  RETURN VALUE: n on success
+ *                -1 on error (errno is set)
+ */
+int sendfd(int fd, void *buf, size_t n, int passed_fd) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct iovec iov = { buf, n };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t n_write;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &passed_fd, sizeof(int));
+
+    // The file descriptor travels with the first byte written
+    while ((n_write = sendmsg(fd, &msg, 0)) == -1) {
+        if (errno != EINTR)
+            // Error
+            return -1;
+    }
+
+    // Write the remaining bytes
+    if (((size_t) n_write < n) && (writen(fd, (char*) buf + n_write, n - n_write) == -1))
+        return -1;
+
+    // Success
+    return n;
+}
+
+/*  Read 'n' byte from UNIX socket 'fd' into the buffer starting at 'buf'.
+ *  The file descriptor passed with them is stored in 'passed_fd', -1 if there is none.
+ *
+ *  RETURN VALUE: n on success
+ *                0 indicates end of file
+ *                -1 on error (errno is set)
+ */
+int recvfd(int fd, void *buf, size_t n, int *passed_fd) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    char *buf_char = (char*) buf;
+    size_t n_left = n;
+    ssize_t n_read;
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    *passed_fd = -1;
+
+    while (n_left > 0) {
+        iov.iov_base = buf_char;
+        iov.iov_len = n_left;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        if ((n_read = recvmsg(fd, &msg, 0)) == -1) {
+            if (errno == EINTR)
+                continue;
+            else
+                // Error
+                return -1;
+        }
+
+        // EOF
+        if (n_read == 0) return 0;
+
+        // Store the passed file descriptor
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS))
+                memcpy(passed_fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+
+        n_left -= n_read;
+        buf_char += n_read;
+    }
+
     // Success
     return n;
 }
\ No newline at end of file
@@ -0,0 +1,333 @@
+#define _GNU_SOURCE // strdup(), DT_DIR
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <watch.h>
+
+/*  Store 'dirname' as the pathname of the watch descriptor 'wd' of the watch pointed to by w.
+ *
+ *  RETURN VALUE: 0 on success
+ *                -1 on error (errno is set)
+ */
+static int set_dir(Watch_t *w, int wd, const char dirname[]) {
+    // The watch descriptors are small integers, the array grows to hold the largest one
+    if ((size_t) wd >= w->dirs_size) {
+        size_t new_size = (w->dirs_size == 0) ? 64 : w->dirs_size;
+        char **new_dirs;
+
+        while (new_size <= (size_t) wd) new_size *= 2;
+
+        if ((new_dirs = realloc(w->dirs, sizeof(char*) * new_size)) == NULL)
+            return -1;
+
+        memset(new_dirs + w->dirs_size, 0, sizeof(char*) * (new_size - w->dirs_size));
+        w->dirs = new_dirs;
+        w->dirs_size = new_size;
+    }
+
+    // A directory moved in the tree keeps its watch descriptor
+    char *path;
+
+    if ((path = strdup(dirname)) == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    free(w->dirs[wd]);
+    w->dirs[wd] = path;
+
+    return 0;
+}
+
+/*  Put 'filename' in the 'requests' queue if it is a valid file, a file that no longer exists is skipped.
+ *
+ *  RETURN VALUE: 1 if the file is put in the queue, 0 if it is skipped
+ *                -1 on error (errno is set)
+ */
+static int add_file(Watch_t *w, char filename[], const struct stat *statbuf, Queue_t *requests) {
+    struct stat buf;
+    FileKey_t key;
+
+    if (statbuf == NULL) {
+        if (stat(filename, &buf) == -1) return (errno == ENOENT) ? 0 : -1;
+
+        statbuf = &buf;
+    }
+
+    // Skip the file if it is not regular or if the format is invalid
+    if (!S_ISREG(statbuf->st_mode)) {
+        fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s': Not a regular file\n", w->progname, filename);
+        return 0;
+    } else if ((statbuf->st_size % sizeof(long)) != 0) {
+        fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s': Invalid format\n", w->progname, filename);
+        return 0;
+    }
+
+    keyFile(&key, statbuf);
+
+    return (pushQueue(requests, filename, &key) == -1) ? -1 : 1;
+}
+
+/*  Watch the directory 'dirname' and its subdirectories, if 'requests' is not NULL the valid files in them are put in the queue.
+ *  The directories removed meanwhile are skipped.
+ *
+ *  RETURN VALUE: number of files put in the queue on success
+ *                -1 on error (errno is set)
+ */
+static int add_tree(Watch_t *w, const char dirname[], Queue_t *requests) {
+    int wd, n = 0, found;
+
+    // Watch the directory before reading it, the files arriving meanwhile are not missed
+    if ((wd = inotify_add_watch(w->fd, dirname, WATCH_EVENTS)) == -1)
+        return ((errno == ENOENT) || (errno == ENOTDIR)) ? 0 : -1;
+
+    if (set_dir(w, wd, dirname) == -1)
+        return -1;
+
+    DIR *dirp;
+
+    if ((dirp = opendir(dirname)) == NULL)
+        return ((errno == ENOENT) || (errno == ENOTDIR)) ? 0 : -1;
+
+    struct dirent *entry;
+    struct stat statbuf;
+    size_t len_dirname = strlen(dirname), len_filename;
+    char filename[w->pathname_max + 1];
+
+    while ((errno = 0, entry = readdir(dirp)) != NULL) {
+        if ((strcmp(".", entry->d_name) == 0) || (strcmp("..", entry->d_name) == 0))
+            continue;
+
+        // Resolve relative path
+        len_filename = strlen(entry->d_name);
+
+        if ((len_dirname + len_filename + 1) > w->pathname_max) {
+            fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s/%s': File name too long (PATHNAME_MAX = %zu)\n", w->progname, dirname, entry->d_name, w->pathname_max);
+            continue;
+        }
+
+        memcpy(filename, dirname, len_dirname);
+        filename[len_dirname] = '/';
+        memcpy(filename + len_dirname + 1, entry->d_name, len_filename + 1);
+
+        // Without the files only the directories are looked for, most file systems report the type of the entry
+        if ((requests == NULL) && (entry->d_type != DT_DIR) && (entry->d_type != DT_LNK) && (entry->d_type != DT_UNKNOWN))
+            continue;
+
+        if (stat(filename, &statbuf) == -1) {
+            if (errno == ENOENT) continue;
+
+            int errsv = errno;
+            closedir(dirp);
+            errno = errsv;
+            return -1;
+        }
+
+        if (S_ISDIR(statbuf.st_mode))
+            found = add_tree(w, filename, requests);
+        else if (requests != NULL)
+            found = add_file(w, filename, &statbuf, requests);
+        else
+            found = 0;
+
+        if (found == -1) {
+            int errsv = errno;
+            closedir(dirp);
+            errno = errsv;
+            return -1;
+        }
+
+        n += found;
+    }
+
+    // Check if an error occurs in readdir()
+    if (errno != 0) {
+        int errsv = errno;
+        closedir(dirp);
+        errno = errsv;
+        return -1;
+    }
+
+    closedir(dirp);
+
+    return n;
+}
+
+// Stop watching the directory of the watch descriptor 'wd' of the watch pointed to by w and its subdirectories
+static void remove_tree(Watch_t *w, int wd) {
+    size_t len = strlen(w->dirs[wd]);
+
+    for (size_t i = 0; i < w->dirs_size; i++) {
+        if ((i != (size_t) wd) && (w->dirs[i] != NULL) && (strncmp(w->dirs[i], w->dirs[wd], len) == 0) && (w->dirs[i][len] == '/')) {
+            inotify_rm_watch(w->fd, i);
+            free(w->dirs[i]);
+            w->dirs[i] = NULL;
+        }
+    }
+
+    inotify_rm_watch(w->fd, wd);
+    free(w->dirs[wd]);
+    w->dirs[wd] = NULL;
+}
+
+/*  Initialize the watch of the directory tree 'dirname' and of its subdirectories.
+ *  Pathnames longer than 'pathname_max' are ignored, warnings are reported with 'progname'.
+ *
+ *  RETURN VALUE: pointer to the new watch on success
+ *                NULL on error (errno is set)
+ */
+Watch_t *initWatch(const char dirname[], size_t pathname_max, const char progname[]) {
+    // Check arguments
+    if ((dirname == NULL) || (progname == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Allocate watch data structure
+    Watch_t *w;
+
+    if ((w = calloc(1, sizeof(Watch_t))) == NULL)
+        return NULL;
+
+    w->fd = -1;
+    w->pathname_max = pathname_max;
+    w->progname = progname;
+
+    // The buffer is aligned for the events read into it
+    if (((w->dirname = strdup(dirname)) == NULL) || ((w->buffer = aligned_alloc(sizeof(struct inotify_event), WATCH_BUF_SIZE)) == NULL)) {
+        deleteWatch(w);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Watch the whole tree, its files are found by the scan of the directory
+    if (((w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) || (add_tree(w, dirname, NULL) == -1)) {
+        int errsv = errno;
+        deleteWatch(w);
+        errno = errsv;
+        return NULL;
+    }
+
+    // Return pointer to the watch
+    return w;
+}
+
+// Delete a watch allocated with initWatch() pointed to by w
+void deleteWatch(Watch_t *w) {
+    if (w != NULL) {
+        if (w->fd != -1) close(w->fd);
+
+        for (size_t i = 0; i < w->dirs_size; i++)
+            free(w->dirs[i]);
+
+        free(w->dirs);
+        free(w->buffer);
+        free(w->dirname);
+        free(w);
+    }
+}
+
+/*  Wait at most 'timeout' ms for the events of the watch pointed to by w and put the files written or moved in the tree
+ *  in the 'requests' queue. The new directories are watched and the files already in them are put in the queue too.
+ *  If the kernel has dropped events the whole tree is read again.
+ *
+ *  RETURN VALUE: number of files put in the queue on success, 0 also if interrupted by a signal handler
+ *                -1 on error (errno is set)
+ */
+int readWatch(Watch_t *w, Queue_t *requests, int timeout) {
+    // Check arguments
+    if ((w == NULL) || (requests == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct pollfd pfd = { .fd = w->fd, .events = POLLIN, .revents = 0 };
+    ssize_t len;
+    int ret;
+
+    if ((ret = poll(&pfd, 1, timeout)) <= 0)
+        return ((ret == 0) || (errno == EINTR)) ? 0 : -1;
+
+    if ((len = read(w->fd, w->buffer, WATCH_BUF_SIZE)) == -1)
+        return ((errno == EINTR) || (errno == EAGAIN)) ? 0 : -1;
+
+    struct inotify_event *event;
+    size_t len_dirname;
+    char filename[w->pathname_max + 1];
+    int n = 0, found;
+
+    for (char *p = w->buffer; p < w->buffer + len; p += sizeof(struct inotify_event) + event->len) {
+        event = (struct inotify_event*) p;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+            fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m events of '%s' dropped, reading the directory again\n", w->progname, w->dirname);
+
+            if ((found = add_tree(w, w->dirname, requests)) == -1) return -1;
+
+            n += found;
+            continue;
+        }
+
+        // Skip the events of the directories no longer watched
+        if ((event->wd < 0) || ((size_t) event->wd >= w->dirs_size) || (w->dirs[event->wd] == NULL))
+            continue;
+
+        // The directory has been removed
+        if (event->mask & IN_IGNORED) {
+            free(w->dirs[event->wd]);
+            w->dirs[event->wd] = NULL;
+            continue;
+        }
+
+        // The directory has been moved: moved in the tree it has already been watched again at its new pathname,
+        // otherwise its pathname and the ones of its subdirectories are stale and they are no longer watched
+        if (event->mask & IN_MOVE_SELF) {
+            int wd = inotify_add_watch(w->fd, w->dirs[event->wd], WATCH_EVENTS);
+
+            if (wd != event->wd) {
+                // Another directory at the old pathname is watched once its creation is read
+                if ((wd != -1) && (((size_t) wd >= w->dirs_size) || (w->dirs[wd] == NULL)))
+                    inotify_rm_watch(w->fd, wd);
+
+                remove_tree(w, event->wd);
+            }
+
+            continue;
+        }
+
+        // A file created is put in the queue once it is closed
+        if ((event->len == 0) || (!(event->mask & IN_ISDIR) && !(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))))
+            continue;
+
+        // Resolve relative path
+        len_dirname = strlen(w->dirs[event->wd]);
+
+        if ((len_dirname + strlen(event->name) + 1) > w->pathname_max) {
+            fprintf(stderr, "%s: \x1B[1;33mwarning:\x1B[0m ignore '%s/%s': File name too long (PATHNAME_MAX = %zu)\n", w->progname, w->dirs[event->wd], event->name, w->pathname_max);
+            continue;
+        }
+
+        memcpy(filename, w->dirs[event->wd], len_dirname);
+        filename[len_dirname] = '/';
+        strcpy(filename + len_dirname + 1, event->name);
+
+        // A new directory is watched and read, the files written before the watch are found there
+        if (event->mask & IN_ISDIR)
+            found = add_tree(w, filename, requests);
+        else
+            found = add_file(w, filename, NULL, requests);
+
+        if (found == -1) return -1;
+
+        n += found;
+    }
+
+    return n;
+}
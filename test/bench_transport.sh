@@ -0,0 +1,41 @@
+#!/bin/bash
+
+#
+# Throughput of the transports of the results to the Collector process (-T shm, -T socket)
+# on a corpus of tiny files, one number each: the run time is dominated by the results path.
+#
+# Usage: ./test/bench_transport.sh [files] [threads]   (default 1000000 files, 4 threads)
+#
+
+N=${1:-1000000}
+THREADS=${2:-4}
+RUNS=3
+
+cd ./bin
+
+if [ ! -e farm ]; then
+    echo "Build farm, missing executable!"
+    exit 1
+fi
+
+CORPUS=$(mktemp -d)
+trap 'rm -rf "$CORPUS"' EXIT
+
+printf "\e[1;36mCREATING CORPUS:\e[0m %d files of 8 bytes in %s\n" $N "$CORPUS"
+head -c $(($N * 8)) /dev/urandom | split -b 8 -a 7 -d - "$CORPUS/f"
+
+# Warm the page cache and the dentry cache
+./farm -n $THREADS -d "$CORPUS" > /dev/null
+
+printf "\e[1;36mRUNNING BENCHMARK:\e[0m %d threads, best of %d runs\n" $THREADS $RUNS
+
+for transport in socket shm; do
+    best=
+    for ((i = 0; i < $RUNS; i++)); do
+        start=$(date +%s%N)
+        ./farm -n $THREADS -T $transport -d "$CORPUS" > /dev/null || exit 1
+        elapsed=$(($(date +%s%N) - $start))
+        if [[ -z $best || $elapsed -lt $best ]]; then best=$elapsed; fi
+    done
+    printf "%-8s %5d ms %10d files/s\n" $transport $(($best / 1000000)) $(($N * 1000000000 / $best))
+done
@@ -107,6 +107,89 @@ else
     echo "test5 passed"
 fi
 
+#
+# cache dei risultati: la seconda esecuzione trova tutti i file nella
+# cache e stampa gli stessi risultati, con -X li ricalcola tutti e un
+# file riscritto viene ricalcolato. I file modificati nell'ultimo
+# secondo non entrano nella cache, quindi vengono retrodatati
+#
+rm -rf cachedir farm.cache
+mkdir cachedir
+cp file*.dat cachedir
+touch -d "2 seconds ago" cachedir/*
+n=$(ls cachedir | wc -l)
+./farm -x farm.cache -d cachedir > cache1.txt 2> /dev/null
+./farm -x farm.cache -d cachedir > cache2.txt 2> cache2.log
+./farm -x farm.cache -X -d cachedir > cache3.txt 2> cache3.log
+./generafile cachedir/file1.dat 500 > /dev/null
+touch -d "2 seconds ago" cachedir/file1.dat
+./farm -x farm.cache -d cachedir > cache4.txt 2> cache4.log
+./farm -d cachedir > cache5.txt
+if diff cache1.txt cache2.txt > /dev/null && diff cache1.txt cache3.txt > /dev/null && diff cache4.txt cache5.txt > /dev/null &&
+   grep -q ": $n hits, 0 grown, 0 misses" cache2.log && grep -q ": 0 hits, 0 grown, $n misses" cache3.log &&
+   grep -q ": $(($n-1)) hits, 0 grown, 1 misses" cache4.log; then
+    echo "test6 passed"
+else
+    echo "test6 failed"
+fi
+rm -rf cachedir farm.cache cache*.txt cache*.log
+
+#
+# ricalcolo incrementale: con -i append di un file cresciuto vengono
+# letti solo i long aggiunti, con -i verify un file il cui inizio e'
+# stato riscritto (il secondo long, il primo ha peso 0) viene letto
+# dall'inizio. I risultati devono essere quelli di un'esecuzione
+# senza cache
+#
+rm -rf incdir farm.cache
+mkdir incdir
+./generafile incdir/grow.dat 1000 > /dev/null
+./generafile incdir/other.dat 300 > /dev/null
+touch -d "2 seconds ago" incdir/*
+./farm -x farm.cache -i verify -d incdir > /dev/null 2>&1
+head -c 800 file2.dat >> incdir/grow.dat
+./farm -x farm.cache -i append -d incdir > inc1.txt 2> inc1.log
+./farm -d incdir > inc2.txt
+printf "farmfarm" | dd of=incdir/grow.dat bs=8 seek=1 count=1 conv=notrunc 2> /dev/null
+./farm -x farm.cache -i verify -d incdir > inc3.txt 2> inc3.log
+./farm -d incdir > inc4.txt
+if diff inc1.txt inc2.txt > /dev/null && diff inc3.txt inc4.txt > /dev/null && ! diff inc2.txt inc4.txt > /dev/null &&
+   grep -q ": 1 hits, 1 grown, 0 misses" inc1.log && grep -q ": 1 hits, 0 grown, 1 misses" inc3.log; then
+    echo "test7 passed"
+else
+    echo "test7 failed"
+fi
+rm -rf incdir farm.cache inc*.txt inc*.log
+
+#
+# modalita' watch: dopo la scansione viene aggiunto un nuovo file e
+# riscritto uno esistente, la stampa richiesta con SIGUSR1 deve essere
+# quella di un'esecuzione sulla directory modificata, con il risultato
+# del file riscritto una sola volta. Il processo termina con SIGTERM
+#
+rm -rf watchdir
+mkdir watchdir
+cp file1.dat file2.dat watchdir
+./farm -w -d watchdir > watch1.txt 2> watch1.log &
+pid=$!
+sleep 1
+cp file3.dat watchdir
+cp file4.dat watchdir/file1.dat
+sleep 1
+kill -SIGUSR1 $pid
+sleep 1
+kill -SIGTERM $pid
+wait $pid
+status=$?
+awk 'BEGIN{RS=""} NR==1{print}' watch1.txt > watch2.txt
+./farm -d watchdir > watch3.txt
+if [ $status -eq 0 ] && diff watch2.txt watch3.txt > /dev/null && [ $(grep -c "watchdir/file1.dat" watch2.txt) -eq 1 ]; then
+    echo "test8 passed"
+else
+    echo "test8 failed"
+fi
+rm -rf watchdir watch*.txt watch*.log
+
 # esempi di utilizzo
 printf "\e[1;36mEXAMPLES:\e[0m\n"
 